@@ -0,0 +1,168 @@
+#include <unistd.h>
+
+#include <cstdlib>
+#include <iostream>
+#include <algorithm>
+
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/json_parser.hpp>
+
+#include "config.h"
+
+std::string config_path()
+{
+    return std::string { std::getenv("HOME") } + "/.wmibov";
+}
+
+namespace {
+
+void load_market(const boost::property_tree::ptree& tree, market_calendar& market)
+{
+    int open, close;
+
+    if (market_calendar::parse_time(tree.get<std::string>("open", "10:00"), open) &&
+        market_calendar::parse_time(tree.get<std::string>("close", "18:00"), close))
+        market.set_session(open, close);
+    else
+        std::cerr << "bad market session, using the default\n";
+
+    market.set_utc_offset(tree.get<int>("utc_offset", -180));
+    market.set_always_open(tree.get<bool>("always_open", false));
+
+    if (const auto days = tree.get_child_optional("days")) {
+        unsigned mask { 0 };
+        for (const auto& v : *days) {
+            const int day { v.second.get_value<int>(-1) };
+            if (day >= 0 && day <= 6)
+                mask |= 1u << day;
+        }
+        market.set_weekdays(mask);
+    }
+
+    if (const auto holidays = tree.get_child_optional("holidays")) {
+        for (const auto& v : *holidays) {
+            int year, month, day;
+            if (market_calendar::parse_date(v.second.data(), year, month, day))
+                market.add_holiday(year, month, day);
+            else
+                std::cerr << "bad holiday " << v.second.data() << "\n";
+        }
+    }
+}
+
+bool load_alert(const boost::property_tree::ptree& tree, alert_config& alert)
+{
+    static const struct
+    {
+        const char *key;
+        alert_kind kind;
+    } kinds[] {
+        { "above", alert_kind::ABOVE },
+        { "below", alert_kind::BELOW },
+        { "percent_move", alert_kind::PERCENT_MOVE },
+        { "move_since_open", alert_kind::MOVE_SINCE_OPEN },
+    };
+
+    alert.symbol = tree.get<std::string>("symbol", "");
+    alert.command = tree.get<std::string>("command", "");
+
+    // the level is read from the text as written, so it's exact
+
+    for (const auto& k : kinds) {
+        if (const auto level = tree.get_optional<std::string>(k.key)) {
+            alert.kind = k.kind;
+            return !alert.symbol.empty() && parse_decimal(level->data(), level->data() + level->size(), alert.level);
+        }
+    }
+
+    return false;
+}
+
+}
+
+bool load_config(const std::string& path, config& conf)
+{
+    if (access(path.c_str(), R_OK) != 0)
+        return false;
+
+    boost::property_tree::ptree tree;
+
+    try {
+        boost::property_tree::read_json(path, tree);
+    } catch (const boost::property_tree::json_parser_error& e) {
+        std::cerr << "failed to parse " << path << ": " << e.what() << "\n";
+        return false;
+    }
+
+    conf.quote_url = tree.get<std::string>("url", conf.quote_url);
+    conf.update_interval = tree.get<int>("interval", 30);
+    conf.min_interval = tree.get<int>("min_interval", 10);
+    conf.closed_interval = tree.get<int>("closed_interval", 1800);
+    conf.retry_interval = tree.get<int>("retry_interval", 5);
+    conf.max_backoff = tree.get<int>("max_backoff", 600);
+    conf.spread_updates = tree.get<bool>("spread", true);
+    conf.shared = tree.get<bool>("shared", false);
+    conf.bus_name = tree.get<std::string>("bus_name", conf.bus_name);
+    conf.max_requests = tree.get<int>("max_requests", 8);
+    conf.connect_timeout = tree.get<int>("connect_timeout", 10);
+    conf.timeout = tree.get<int>("timeout", 30);
+    if (conf.timeout <= 0) {
+        // every fetch's budget is capped at this, so it can't mean "no limit" as it does to curl
+        std::cerr << "bad timeout " << conf.timeout << ", using the default\n";
+        conf.timeout = 30;
+    }
+    conf.verbose = tree.get<bool>("verbose", false);
+    conf.history_size = std::max(tree.get<int>("history_size", 256), 1);
+    conf.stats = tree.get<bool>("stats", false);
+    conf.stats_file = tree.get<std::string>("stats_file", "");
+    conf.stats_interval = tree.get<int>("stats_interval", 0);
+
+    if (const auto providers = tree.get_child_optional("providers")) {
+        for (const auto& v : *providers) {
+            provider_config provider;
+            provider.url = v.second.get<std::string>("url", "");
+            provider.name = v.second.get<std::string>("name", provider.url);
+            provider.fields.last = v.second.get<std::string>("last", provider.fields.last);
+            provider.fields.change = v.second.get<std::string>("change", provider.fields.change);
+            provider.fields.percent_change = v.second.get<std::string>("percent_change", provider.fields.percent_change);
+
+            if (provider.url.empty())
+                std::cerr << "quote provider " << provider.name << " has no url, ignoring\n";
+            else
+                conf.providers.push_back(provider);
+        }
+    }
+
+    if (const auto stream = tree.get_child_optional("stream")) {
+        conf.stream.url = stream->get<std::string>("url", "");
+        conf.stream.symbol_key = stream->get<std::string>("symbol", conf.stream.symbol_key);
+        conf.stream.fields.last = stream->get<std::string>("last", conf.stream.fields.last);
+        conf.stream.fields.change = stream->get<std::string>("change", conf.stream.fields.change);
+        conf.stream.fields.percent_change = stream->get<std::string>("percent_change", conf.stream.fields.percent_change);
+    }
+
+    if (const auto alerts = tree.get_child_optional("alerts")) {
+        for (const auto& v : *alerts) {
+            alert_config alert;
+            if (load_alert(v.second, alert))
+                conf.alerts.push_back(alert);
+            else
+                std::cerr << "bad alert for " << v.second.get<std::string>("symbol", "no symbol") << ", ignoring\n";
+        }
+    }
+
+    if (const auto market = tree.get_child_optional("market"))
+        load_market(*market, conf.market);
+
+    if (const auto symbols = tree.get_child_optional("symbols")) {
+        conf.symbols.clear();
+        std::transform(
+                std::begin(*symbols),
+                std::end(*symbols),
+                std::back_inserter(conf.symbols),
+                [](const boost::property_tree::ptree::value_type& v)
+                { return v.second.data(); });
+    }
+
+    return true;
+}
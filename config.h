@@ -0,0 +1,63 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "market_calendar.h"
+#include "decimal.h"
+#include "quote_parser.h"
+
+struct provider_config
+{
+    std::string name;
+    std::string url;
+    quote_fields fields;
+};
+
+// server-sent events feed; each event's data is a JSON object with the symbol and values
+struct stream_config
+{
+    std::string url; // disabled if empty
+    std::string symbol_key { "symbol" };
+    quote_fields fields;
+};
+
+enum class alert_kind { ABOVE, BELOW, PERCENT_MOVE, MOVE_SINCE_OPEN };
+
+// fires when the value crosses level; the moves fire both ways, through +level and -level
+struct alert_config
+{
+    std::string symbol;
+    alert_kind kind;
+    decimal level;
+    std::string command; // run through sh when it fires, if not empty
+};
+
+struct config
+{
+    std::vector<std::string> symbols { "BVSP" };
+    std::string quote_url { "http://exame.abril.com.br/coletor/quote/" };
+    std::vector<provider_config> providers; // in order of preference; just quote_url if empty
+    stream_config stream;
+    std::vector<alert_config> alerts;
+    int update_interval = 30;
+    int min_interval = 10;
+    int closed_interval = 1800;
+    int retry_interval = 5;
+    int max_backoff = 600;
+    bool spread_updates = true;
+    market_calendar market;
+    bool shared = false;
+    std::string bus_name { "/wmibov" };
+    int max_requests = 8;
+    int connect_timeout = 10;
+    int timeout = 30;
+    bool verbose = false;
+    int history_size = 256;
+    bool stats = false;
+    std::string stats_file;
+    int stats_interval = 0;
+};
+
+std::string config_path();
+bool load_config(const std::string& path, config& conf);
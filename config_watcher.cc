@@ -0,0 +1,58 @@
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <iostream>
+
+#include "config_watcher.h"
+
+config_watcher::~config_watcher()
+{
+    if (m_fd != -1)
+        close(m_fd);
+}
+
+bool config_watcher::open(const std::string& path)
+{
+    const auto slash = path.rfind('/');
+    const std::string directory { slash == std::string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash) };
+    m_name = slash == std::string::npos ? path : path.substr(slash + 1);
+
+    m_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_fd == -1) {
+        std::cerr << "failed to create inotify fd\n";
+        return false;
+    }
+
+    if (inotify_add_watch(m_fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) == -1) {
+        std::cerr << "failed to watch " << directory << "\n";
+        close(m_fd);
+        m_fd = -1;
+        return false;
+    }
+
+    return true;
+}
+
+int config_watcher::fd() const
+{
+    return m_fd;
+}
+
+bool config_watcher::changed()
+{
+    alignas(inotify_event) char buffer[4096];
+    bool changed { false };
+    ssize_t bytes;
+
+    while ((bytes = read(m_fd, buffer, sizeof(buffer))) > 0) {
+        for (char *p = buffer; p < buffer + bytes; ) {
+            const auto event = reinterpret_cast<const inotify_event *>(p);
+            if (event->len && m_name == event->name)
+                changed = true;
+            p += sizeof(inotify_event) + event->len;
+        }
+    }
+
+    return changed;
+}
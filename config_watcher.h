@@ -0,0 +1,25 @@
+#pragma once
+
+#include <string>
+
+#include <boost/core/noncopyable.hpp>
+
+// Watches the config file through inotify on its directory, so that editors which save by
+// writing a new file and renaming it over the old one are noticed too.
+
+class config_watcher : private boost::noncopyable
+{
+public:
+    config_watcher() = default;
+    ~config_watcher();
+
+    bool open(const std::string& path);
+    int fd() const;
+
+    // drains the pending events; true if the file was rewritten or replaced
+    bool changed();
+
+private:
+    std::string m_name;
+    int m_fd = -1;
+};
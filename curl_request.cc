@@ -1,3 +1,7 @@
+#include <strings.h>
+
+#include <cstring>
+
 #include "curl_request.h"
 
 curl_request::curl_request()
@@ -5,11 +9,19 @@ curl_request::curl_request()
 {
     curl_easy_setopt(m_curl, CURLOPT_WRITEFUNCTION, static_write_callback);
     curl_easy_setopt(m_curl, CURLOPT_WRITEDATA, this);
+    curl_easy_setopt(m_curl, CURLOPT_PRIVATE, this);
+    curl_easy_setopt(m_curl, CURLOPT_HEADERFUNCTION, static_header_callback);
+    curl_easy_setopt(m_curl, CURLOPT_HEADERDATA, this);
+    curl_easy_setopt(m_curl, CURLOPT_NOSIGNAL, 1l);
+
+    // an empty string offers every encoding this libcurl can decode
+    curl_easy_setopt(m_curl, CURLOPT_ACCEPT_ENCODING, "");
 }
 
 curl_request::~curl_request()
 {
     curl_easy_cleanup(m_curl);
+    curl_slist_free_all(m_headers);
 }
 
 size_t curl_request::static_write_callback(char *buffer, size_t size, size_t nmemb, void *userp)
@@ -25,17 +37,103 @@ size_t curl_request::write_callback(char *buffer, size_t size, size_t nmemb)
     return bytes;
 }
 
+size_t curl_request::static_header_callback(char *buffer, size_t size, size_t nitems, void *userp)
+{
+    auto self = reinterpret_cast<curl_request *>(userp);
+    return self->header_callback(buffer, size, nitems);
+}
+
+size_t curl_request::header_callback(char *buffer, size_t size, size_t nitems)
+{
+    const size_t bytes { size*nitems };
+
+    const auto value = [&](const char *name, std::string& value) {
+        const size_t length { strlen(name) };
+
+        if (bytes <= length || strncasecmp(buffer, name, length) != 0 || buffer[length] != ':')
+            return;
+
+        const char *begin { buffer + length + 1 };
+        const char *end { buffer + bytes };
+
+        while (begin != end && (*begin == ' ' || *begin == '\t'))
+            ++begin;
+        while (end != begin && (end[-1] == '\r' || end[-1] == '\n' || end[-1] == ' '))
+            --end;
+
+        value.assign(begin, end);
+    };
+
+    value("ETag", m_etag);
+    value("Last-Modified", m_last_modified);
+
+    return bytes;
+}
+
 void curl_request::set_url(const std::string& url)
 {
     curl_easy_setopt(m_curl, CURLOPT_URL, url.c_str());
 }
 
+void curl_request::set_share(CURLSH *share)
+{
+    curl_easy_setopt(m_curl, CURLOPT_SHARE, share);
+}
+
+void curl_request::set_timeouts(long connect_timeout, std::chrono::milliseconds timeout)
+{
+    curl_easy_setopt(m_curl, CURLOPT_CONNECTTIMEOUT, connect_timeout);
+    curl_easy_setopt(m_curl, CURLOPT_TIMEOUT_MS, static_cast<long>(timeout.count()));
+}
+
+void curl_request::set_validators(const std::string& etag, const std::string& last_modified)
+{
+    // the same quote usually lands on the same request with the same validators, so only
+    // rebuild the list when they change; the strings are assigned in place to keep their storage
+
+    if (etag == m_sent_etag && last_modified == m_sent_last_modified)
+        return;
+
+    m_sent_etag = etag;
+    m_sent_last_modified = last_modified;
+
+    curl_slist_free_all(m_headers);
+    m_headers = nullptr;
+
+    if (!etag.empty()) {
+        m_header_line.assign("If-None-Match: ").append(etag);
+        m_headers = curl_slist_append(m_headers, m_header_line.c_str());
+    }
+    if (!last_modified.empty()) {
+        m_header_line.assign("If-Modified-Since: ").append(last_modified);
+        m_headers = curl_slist_append(m_headers, m_header_line.c_str());
+    }
+
+    curl_easy_setopt(m_curl, CURLOPT_HTTPHEADER, m_headers);
+}
+
 bool curl_request::fetch()
+{
+    start();
+    return finish(curl_easy_perform(m_curl));
+}
+
+CURL *curl_request::handle() const
+{
+    return m_curl;
+}
+
+void curl_request::start()
 {
     m_buffer.clear();
+    m_etag.clear();
+    m_last_modified.clear();
     m_response_code = 0;
+}
 
-    if (curl_easy_perform(m_curl) != CURLE_OK)
+bool curl_request::finish(CURLcode result)
+{
+    if (result != CURLE_OK)
         return false;
 
     curl_easy_getinfo(m_curl, CURLINFO_RESPONSE_CODE, &m_response_code);
@@ -43,6 +141,13 @@ bool curl_request::fetch()
     return true;
 }
 
+curl_request *curl_request::from_handle(CURL *handle)
+{
+    char *self { nullptr };
+    curl_easy_getinfo(handle, CURLINFO_PRIVATE, &self);
+    return reinterpret_cast<curl_request *>(self);
+}
+
 const std::string& curl_request::buffer() const
 {
     return m_buffer;
@@ -52,3 +157,13 @@ long curl_request::response_code() const
 {
     return m_response_code;
 }
+
+const std::string& curl_request::etag() const
+{
+    return m_etag;
+}
+
+const std::string& curl_request::last_modified() const
+{
+    return m_last_modified;
+}
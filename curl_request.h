@@ -1,5 +1,6 @@
 #pragma once
 
+#include <chrono>
 #include <string>
 #include <curl/curl.h>
 #include <boost/core/noncopyable.hpp>
@@ -11,15 +12,39 @@ public:
     ~curl_request();
 
     void set_url(const std::string& url);
+    void set_share(CURLSH *share);
+    void set_timeouts(long connect_timeout, std::chrono::milliseconds timeout);
+
+    // validators from an earlier response; the server answers 304 if nothing changed
+    void set_validators(const std::string& etag, const std::string& last_modified);
+    const std::string& etag() const;
+    const std::string& last_modified() const;
+
     bool fetch();
     const std::string& buffer() const;
     long response_code() const;
 
+    // for driving the transfer from a curl multi handle
+
+    CURL *handle() const;
+    void start();
+    bool finish(CURLcode result);
+
+    static curl_request *from_handle(CURL *handle);
+
 private:
     static size_t static_write_callback(char *buffer, size_t size, size_t nmemb, void *userp);
     size_t write_callback(char *buffer, size_t size, size_t nmemb);
+    static size_t static_header_callback(char *buffer, size_t size, size_t nitems, void *userp);
+    size_t header_callback(char *buffer, size_t size, size_t nitems);
 
     std::string m_buffer;
+    std::string m_etag;
+    std::string m_last_modified;
+    std::string m_sent_etag;
+    std::string m_sent_last_modified;
+    std::string m_header_line;
+    curl_slist *m_headers = nullptr;
     long m_response_code = 0;
     CURL *m_curl;
 };
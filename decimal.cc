@@ -0,0 +1,186 @@
+#include "decimal.h"
+
+namespace {
+
+const uint64_t powers_of_ten[] {
+    1ull, 10ull, 100ull, 1000ull, 10000ull, 100000ull, 1000000ull, 10000000ull, 100000000ull,
+    1000000000ull, 10000000000ull, 100000000000ull, 1000000000000ull, 10000000000000ull,
+    100000000000000ull, 1000000000000000ull, 10000000000000000ull, 100000000000000000ull,
+    1000000000000000000ull, 10000000000000000000ull,
+};
+const int max_power { sizeof(powers_of_ten)/sizeof(*powers_of_ten) - 1 };
+
+uint64_t magnitude(int64_t value)
+{
+    return value < 0 ? 0ull - static_cast<uint64_t>(value) : static_cast<uint64_t>(value);
+}
+
+// digits of value, zero-padded to min_digits, written backwards from end; returns the start
+char *write_digits(char *end, uint64_t value, int min_digits)
+{
+    char *p { end };
+    do {
+        *--p = '0' + value%10;
+        value /= 10;
+        --min_digits;
+    } while (value || min_digits > 0);
+    return p;
+}
+
+int finish(char *buf, bool negative, bool force_sign, const char *begin, const char *end)
+{
+    char *p { buf };
+    if (negative)
+        *p++ = '-';
+    else if (force_sign)
+        *p++ = '+';
+
+    while (begin != end)
+        *p++ = *begin++;
+    *p = '\0';
+
+    return p - buf;
+}
+
+}
+
+int64_t decimal::round(int places) const
+{
+    const int64_t divisor = powers_of_ten[PLACES - places];
+
+    int64_t result { m_units/divisor };
+    const int64_t remainder { m_units%divisor };
+
+    if (remainder >= 0 ? remainder >= divisor - remainder : -remainder >= divisor + remainder)
+        result += remainder >= 0 ? 1 : -1;
+
+    return result;
+}
+
+bool parse_decimal(const char *pos, const char *end, decimal& value)
+{
+    bool negative { false };
+    if (pos != end && (*pos == '-' || *pos == '+'))
+        negative = *pos++ == '-';
+
+    // up to 19 significant digits are kept; the rest only shift the exponent or are dropped
+
+    uint64_t mantissa { 0 };
+    int digits { 0 }, exponent { 0 };
+    bool seen_digit { false };
+
+    for (; pos != end && *pos >= '0' && *pos <= '9'; ++pos) {
+        seen_digit = true;
+        if (digits < 19) {
+            mantissa = mantissa*10 + (*pos - '0');
+            if (mantissa)
+                ++digits;
+        } else {
+            ++exponent;
+        }
+    }
+
+    if (pos != end && *pos == '.') {
+        ++pos;
+        for (; pos != end && *pos >= '0' && *pos <= '9'; ++pos) {
+            seen_digit = true;
+            if (digits < 19) {
+                mantissa = mantissa*10 + (*pos - '0');
+                if (mantissa)
+                    ++digits;
+                --exponent;
+            }
+        }
+    }
+
+    if (!seen_digit)
+        return false;
+
+    if (pos != end && (*pos == 'e' || *pos == 'E')) {
+        ++pos;
+
+        bool negative_exponent { false };
+        if (pos != end && (*pos == '-' || *pos == '+'))
+            negative_exponent = *pos++ == '-';
+
+        if (pos == end || *pos < '0' || *pos > '9')
+            return false;
+
+        int explicit_exponent { 0 };
+        for (; pos != end && *pos >= '0' && *pos <= '9'; ++pos) {
+            if (explicit_exponent < 10000)
+                explicit_exponent = explicit_exponent*10 + (*pos - '0');
+        }
+
+        exponent += negative_exponent ? -explicit_exponent : explicit_exponent;
+    }
+
+    if (pos != end)
+        return false;
+
+    // mantissa*10^exponent in millionths
+
+    const int shift { exponent + decimal::PLACES };
+    uint64_t units { 0 };
+
+    if (mantissa == 0) {
+        units = 0;
+    } else if (shift >= 0) {
+        if (shift > max_power || mantissa > INT64_MAX/powers_of_ten[shift])
+            return false;
+        units = mantissa*powers_of_ten[shift];
+    } else if (-shift <= max_power) {
+        const uint64_t divisor { powers_of_ten[-shift] };
+        const uint64_t remainder { mantissa%divisor };
+        units = mantissa/divisor + (remainder >= divisor - remainder ? 1 : 0);
+    }
+
+    if (units > INT64_MAX)
+        return false;
+
+    value = decimal::from_units(negative ? -static_cast<int64_t>(units) : static_cast<int64_t>(units));
+    return true;
+}
+
+int format_decimal(char *buf, decimal value)
+{
+    const uint64_t units { magnitude(value.units()) };
+    const uint64_t scale = decimal::SCALE;
+
+    char text[decimal::TEXT_SIZE];
+    char *const end { text + sizeof(text) };
+    char *begin { end };
+
+    uint64_t fraction { units%scale };
+    if (fraction) {
+        int places { decimal::PLACES };
+        while (fraction%10 == 0) {
+            fraction /= 10;
+            --places;
+        }
+        begin = write_digits(begin, fraction, places);
+        *--begin = '.';
+    }
+    begin = write_digits(begin, units/scale, 1);
+
+    return finish(buf, value.units() < 0, false, begin, end);
+}
+
+int format_decimal(char *buf, decimal value, int places, bool force_sign)
+{
+    const int64_t rounded { value.round(places) };
+    const uint64_t units { magnitude(rounded) };
+    const uint64_t scale { powers_of_ten[places] };
+
+    char text[decimal::TEXT_SIZE];
+    char *const end { text + sizeof(text) };
+    char *begin { end };
+
+    if (places > 0) {
+        begin = write_digits(begin, units%scale, places);
+        *--begin = '.';
+    }
+    begin = write_digits(begin, units/scale, 1);
+
+    return finish(buf, rounded < 0, force_sign, begin, end);
+}
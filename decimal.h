@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Fixed-point quote value held as a count of millionths, so that prices, changes and
+// percentages go from the response text to the screen without floating point: parsed
+// straight from the digits, compared exactly and formatted with integer arithmetic.
+
+class decimal
+{
+public:
+    static const int PLACES = 6;
+    static const int64_t SCALE = 1000000;
+
+    // enough for any formatted value, with sign, point and terminator
+    static const size_t TEXT_SIZE = 24;
+
+    decimal() = default;
+
+    static decimal from_units(int64_t units)
+    {
+        decimal d;
+        d.m_units = units;
+        return d;
+    }
+
+    int64_t units() const { return m_units; }
+
+    // rounded half away from zero to places (0 to PLACES) decimals, as a count of 10^-places
+    int64_t round(int places) const;
+
+    bool operator==(decimal other) const { return m_units == other.m_units; }
+    bool operator!=(decimal other) const { return m_units != other.m_units; }
+    bool operator<(decimal other) const { return m_units < other.m_units; }
+    bool operator>(decimal other) const { return m_units > other.m_units; }
+
+    decimal operator-() const { return from_units(-m_units); }
+    decimal operator-(decimal other) const { return from_units(m_units - other.m_units); }
+
+private:
+    int64_t m_units = 0;
+};
+
+// A JSON number: optional sign, digits, optional fraction and exponent. Digits past the
+// sixth place are rounded off; false if malformed or out of range.
+bool parse_decimal(const char *begin, const char *end, decimal& value);
+
+// shortest exact text, without exponent or trailing zeros; returns the length
+int format_decimal(char *buf, decimal value);
+
+// rounded to places decimals, always showing them; returns the length
+int format_decimal(char *buf, decimal value, int places, bool force_sign);
@@ -0,0 +1,269 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#include "fetch_stats.h"
+
+int64_t steady_clock_micros()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+latency_histogram::latency_histogram()
+{
+    for (auto& bucket : m_buckets)
+        bucket.store(0, std::memory_order_relaxed);
+}
+
+int latency_histogram::bucket_index(uint64_t value)
+{
+    if (value < LINEAR_BUCKETS)
+        return value;
+
+    const int exponent { 63 - __builtin_clzll(value) };
+    if (exponent >= MAX_EXPONENT)
+        return NUM_BUCKETS - 1;
+
+    return LINEAR_BUCKETS + (exponent - 4)*SUB_BUCKETS + ((value >> (exponent - 3)) & (SUB_BUCKETS - 1));
+}
+
+uint64_t latency_histogram::bucket_value(int index)
+{
+    if (index < LINEAR_BUCKETS)
+        return index;
+
+    const int exponent { (index - LINEAR_BUCKETS)/SUB_BUCKETS + 4 };
+    const int sub_bucket { (index - LINEAR_BUCKETS)%SUB_BUCKETS };
+    const uint64_t width { 1ull << (exponent - 3) };
+
+    return (SUB_BUCKETS + sub_bucket)*width + width/2;
+}
+
+void latency_histogram::record(uint64_t value)
+{
+    m_buckets[bucket_index(value)].fetch_add(1, std::memory_order_relaxed);
+    m_count.fetch_add(1, std::memory_order_relaxed);
+    m_sum.fetch_add(value, std::memory_order_relaxed);
+
+    uint64_t max { m_max.load(std::memory_order_relaxed) };
+    while (value > max && !m_max.compare_exchange_weak(max, value, std::memory_order_relaxed))
+        ;
+}
+
+uint64_t latency_histogram::count() const
+{
+    return m_count.load(std::memory_order_relaxed);
+}
+
+uint64_t latency_histogram::percentile(double p) const
+{
+    const uint64_t count { this->count() };
+    if (count == 0)
+        return 0;
+
+    const uint64_t rank { std::max<uint64_t>(static_cast<uint64_t>(std::ceil(p*count)), 1) };
+
+    uint64_t seen { 0 };
+    for (int i = 0; i < NUM_BUCKETS; ++i) {
+        seen += m_buckets[i].load(std::memory_order_relaxed);
+        if (seen >= rank)
+            return std::min(bucket_value(i), m_max.load(std::memory_order_relaxed));
+    }
+
+    return m_max.load(std::memory_order_relaxed);
+}
+
+void latency_histogram::dump(std::ostream& out) const
+{
+    const uint64_t count { this->count() };
+
+    out << "{\"count\":" << count
+        << ",\"mean\":" << (count ? m_sum.load(std::memory_order_relaxed)/count : 0)
+        << ",\"p50\":" << percentile(.5)
+        << ",\"p90\":" << percentile(.9)
+        << ",\"p99\":" << percentile(.99)
+        << ",\"max\":" << m_max.load(std::memory_order_relaxed)
+        << "}";
+}
+
+fetch_stats::fetch_stats()
+{
+    m_quotes.reserve(quote_table::MAX_QUOTES);
+}
+
+void fetch_stats::add_quote()
+{
+    m_quotes.emplace_back(new quote_stats);
+}
+
+void fetch_stats::record_fetch(quote_id id, const timings& t)
+{
+    m_dns.record(t.dns);
+    m_connect.record(t.connect);
+    m_tls.record(t.tls);
+    m_first_byte.record(t.first_byte);
+    m_total.record(t.total);
+
+    m_requests.fetch_add(1, std::memory_order_relaxed);
+    m_bytes.fetch_add(t.bytes, std::memory_order_relaxed);
+    m_decoded_bytes.fetch_add(t.decoded_bytes, std::memory_order_relaxed);
+    if (t.decoded_bytes > t.bytes)
+        m_compression_saved.fetch_add(t.decoded_bytes - t.bytes, std::memory_order_relaxed);
+
+    auto& quote = *m_quotes[id];
+    quote.requests.fetch_add(1, std::memory_order_relaxed);
+    quote.bytes.fetch_add(t.bytes, std::memory_order_relaxed);
+    quote.total.record(t.total);
+}
+
+void fetch_stats::record_parse(uint64_t micros)
+{
+    m_parse.record(micros);
+}
+
+void fetch_stats::record_publish(uint64_t micros)
+{
+    m_publish.record(micros);
+}
+
+void fetch_stats::record_not_modified(uint64_t saved_bytes)
+{
+    m_not_modified.fetch_add(1, std::memory_order_relaxed);
+    m_not_modified_saved.fetch_add(saved_bytes, std::memory_order_relaxed);
+}
+
+void fetch_stats::record_error(quote_id id, fetch_error cause)
+{
+    switch (cause) {
+    case fetch_error::NETWORK:
+        m_network_errors.fetch_add(1, std::memory_order_relaxed);
+        break;
+    case fetch_error::HTTP:
+        m_http_errors.fetch_add(1, std::memory_order_relaxed);
+        break;
+    case fetch_error::PARSE:
+        m_parse_errors.fetch_add(1, std::memory_order_relaxed);
+        break;
+    }
+
+    m_quotes[id]->errors.fetch_add(1, std::memory_order_relaxed);
+}
+
+void fetch_stats::record_retry()
+{
+    m_retries.fetch_add(1, std::memory_order_relaxed);
+}
+
+void fetch_stats::record_hedge()
+{
+    m_hedges.fetch_add(1, std::memory_order_relaxed);
+}
+
+void fetch_stats::record_hedge_win()
+{
+    m_hedge_wins.fetch_add(1, std::memory_order_relaxed);
+}
+
+void fetch_stats::record_failover()
+{
+    m_failovers.fetch_add(1, std::memory_order_relaxed);
+}
+
+void fetch_stats::record_overdue()
+{
+    m_overdue.fetch_add(1, std::memory_order_relaxed);
+}
+
+void fetch_stats::record_tick()
+{
+    m_ticks.fetch_add(1, std::memory_order_relaxed);
+}
+
+void fetch_stats::record_stream_drop()
+{
+    m_stream_drops.fetch_add(1, std::memory_order_relaxed);
+}
+
+void fetch_stats::record_alert()
+{
+    m_alerts.fetch_add(1, std::memory_order_relaxed);
+}
+
+void fetch_stats::record_display(uint64_t micros)
+{
+    m_display.record(micros);
+}
+
+void fetch_stats::record_first_paint(uint64_t millis)
+{
+    m_first_paint.store(millis, std::memory_order_relaxed);
+}
+
+void fetch_stats::dump(std::ostream& out, const std::vector<std::string>& symbols) const
+{
+    // one JSON object per dump, on a single line
+
+    out << "{\"time\":" << time(nullptr)
+        << ",\"first_paint_ms\":" << m_first_paint.load(std::memory_order_relaxed)
+        << ",\"requests\":" << m_requests.load(std::memory_order_relaxed)
+        << ",\"retries\":" << m_retries.load(std::memory_order_relaxed)
+        << ",\"hedges\":" << m_hedges.load(std::memory_order_relaxed)
+        << ",\"hedge_wins\":" << m_hedge_wins.load(std::memory_order_relaxed)
+        << ",\"failovers\":" << m_failovers.load(std::memory_order_relaxed)
+        << ",\"overdue\":" << m_overdue.load(std::memory_order_relaxed)
+        << ",\"ticks\":" << m_ticks.load(std::memory_order_relaxed)
+        << ",\"stream_drops\":" << m_stream_drops.load(std::memory_order_relaxed)
+        << ",\"alerts\":" << m_alerts.load(std::memory_order_relaxed)
+        << ",\"bytes\":" << m_bytes.load(std::memory_order_relaxed)
+        << ",\"decoded_bytes\":" << m_decoded_bytes.load(std::memory_order_relaxed)
+        << ",\"not_modified\":" << m_not_modified.load(std::memory_order_relaxed)
+        << ",\"saved_bytes\":{\"compression\":" << m_compression_saved.load(std::memory_order_relaxed)
+        << ",\"not_modified\":" << m_not_modified_saved.load(std::memory_order_relaxed)
+        << "},\"errors\":{\"network\":" << m_network_errors.load(std::memory_order_relaxed)
+        << ",\"http\":" << m_http_errors.load(std::memory_order_relaxed)
+        << ",\"parse\":" << m_parse_errors.load(std::memory_order_relaxed)
+        << "},\"latency_us\":{";
+
+    const struct
+    {
+        const char *name;
+        const latency_histogram& histogram;
+    } histograms[] {
+        { "dns", m_dns },
+        { "connect", m_connect },
+        { "tls", m_tls },
+        { "first_byte", m_first_byte },
+        { "total", m_total },
+        { "parse", m_parse },
+        { "publish", m_publish },
+        { "display", m_display },
+    };
+
+    bool first { true };
+    for (const auto& h : histograms) {
+        out << (first ? "" : ",") << "\"" << h.name << "\":";
+        h.histogram.dump(out);
+        first = false;
+    }
+
+    out << "},\"symbols\":{";
+
+    for (size_t id = 0; id < m_quotes.size() && id < symbols.size(); ++id) {
+        const auto& quote = *m_quotes[id];
+
+        out << (id ? "," : "") << "\"";
+        for (auto ch : symbols[id]) {
+            if (ch == '"' || ch == '\\')
+                out << '\\';
+            out << ch;
+        }
+        out << "\":{\"requests\":" << quote.requests.load(std::memory_order_relaxed)
+            << ",\"errors\":" << quote.errors.load(std::memory_order_relaxed)
+            << ",\"bytes\":" << quote.bytes.load(std::memory_order_relaxed)
+            << ",\"total_us\":";
+        quote.total.dump(out);
+        out << "}";
+    }
+
+    out << "}}\n";
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <boost/core/noncopyable.hpp>
+
+#include "quote_table.h"
+
+// Log-linear histogram of microsecond values: exact below 16, then 8 buckets per power of
+// two (about 12% resolution). Recording is a couple of relaxed atomic adds.
+
+class latency_histogram : private boost::noncopyable
+{
+public:
+    latency_histogram();
+
+    void record(uint64_t value);
+    uint64_t count() const;
+    uint64_t percentile(double p) const;
+    void dump(std::ostream& out) const;
+
+private:
+    static const int LINEAR_BUCKETS = 16;
+    static const int SUB_BUCKETS = 8;
+    static const int MAX_EXPONENT = 40;
+    static const int NUM_BUCKETS = LINEAR_BUCKETS + (MAX_EXPONENT - 4)*SUB_BUCKETS;
+
+    static int bucket_index(uint64_t value);
+    static uint64_t bucket_value(int index);
+
+    std::atomic<uint64_t> m_buckets[NUM_BUCKETS];
+    std::atomic<uint64_t> m_count { 0 };
+    std::atomic<uint64_t> m_sum { 0 };
+    std::atomic<uint64_t> m_max { 0 };
+};
+
+// for timestamps that travel with a quote, like quote_snapshot::received
+int64_t steady_clock_micros();
+
+enum class fetch_error { NETWORK, HTTP, PARSE };
+
+// Per-fetch timings and counters, global and per quote. Written from the fetcher and UI
+// threads without locking; only allocated when stats are enabled.
+
+class fetch_stats : private boost::noncopyable
+{
+public:
+    struct timings
+    {
+        uint64_t dns;
+        uint64_t connect;
+        uint64_t tls;
+        uint64_t first_byte;
+        uint64_t total;
+        uint64_t bytes;
+        uint64_t decoded_bytes;
+    };
+
+    fetch_stats();
+
+    void add_quote();
+
+    void record_fetch(quote_id id, const timings& t);
+    void record_parse(uint64_t micros);
+    void record_publish(uint64_t micros);
+    void record_not_modified(uint64_t saved_bytes);
+    void record_error(quote_id id, fetch_error cause);
+    void record_retry();
+    void record_hedge();
+    void record_hedge_win();
+    void record_failover();
+    void record_overdue();
+    void record_tick();
+    void record_stream_drop();
+    void record_alert();
+    void record_first_paint(uint64_t millis);
+
+    // from the values arriving to them being on screen or written out
+    void record_display(uint64_t micros);
+
+    void dump(std::ostream& out, const std::vector<std::string>& symbols) const;
+
+private:
+    struct quote_stats
+    {
+        std::atomic<uint64_t> requests { 0 };
+        std::atomic<uint64_t> errors { 0 };
+        std::atomic<uint64_t> bytes { 0 };
+        latency_histogram total;
+    };
+
+    latency_histogram m_dns;
+    latency_histogram m_connect;
+    latency_histogram m_tls;
+    latency_histogram m_first_byte;
+    latency_histogram m_total;
+    latency_histogram m_parse;
+    latency_histogram m_publish;
+    latency_histogram m_display;
+
+    std::atomic<uint64_t> m_requests { 0 };
+    std::atomic<uint64_t> m_retries { 0 };
+    std::atomic<uint64_t> m_hedges { 0 };
+    std::atomic<uint64_t> m_hedge_wins { 0 };
+    std::atomic<uint64_t> m_failovers { 0 };
+    std::atomic<uint64_t> m_overdue { 0 };
+    std::atomic<uint64_t> m_ticks { 0 };
+    std::atomic<uint64_t> m_stream_drops { 0 };
+    std::atomic<uint64_t> m_alerts { 0 };
+    std::atomic<uint64_t> m_bytes { 0 };
+    std::atomic<uint64_t> m_decoded_bytes { 0 };
+    std::atomic<uint64_t> m_not_modified { 0 };
+    std::atomic<uint64_t> m_compression_saved { 0 };
+    std::atomic<uint64_t> m_not_modified_saved { 0 };
+    std::atomic<uint64_t> m_network_errors { 0 };
+    std::atomic<uint64_t> m_http_errors { 0 };
+    std::atomic<uint64_t> m_parse_errors { 0 };
+    std::atomic<uint64_t> m_first_paint { 0 };
+
+    // reserved up front, so adding a quote never moves the ones the fetcher is updating
+    std::vector<std::unique_ptr<quote_stats>> m_quotes;
+};
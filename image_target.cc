@@ -0,0 +1,179 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#include "image_target.h"
+
+#include "font_white.xpm"
+#include "font_green.xpm"
+#include "font_red.xpm"
+#include "font_yellow.xpm"
+
+namespace {
+
+const uint32_t BLACK { 0x000000 };
+const uint32_t GRAPH { 0x999999 }; // gray60, as in wm_window
+
+// a font pixmap decoded once; the fonts are two color, black and the one named in the XPM
+
+struct font_image
+{
+    int width = 0, height = 0;
+    std::vector<uint32_t> pixels;
+};
+
+uint32_t named_color(const char *name)
+{
+    if (!strcmp(name, "white"))
+        return 0xffffff;
+    if (!strcmp(name, "green"))
+        return 0x00ff00;
+    if (!strcmp(name, "red"))
+        return 0xff0000;
+    if (!strcmp(name, "yellow"))
+        return 0xffff00;
+    return BLACK;
+}
+
+font_image decode_xpm(char *const *xpm)
+{
+    font_image image;
+
+    int colors, chars;
+    if (sscanf(xpm[0], "%d %d %d %d", &image.width, &image.height, &colors, &chars) != 4 || chars != 1) {
+        std::cerr << "unexpected font pixmap\n";
+        abort();
+    }
+
+    uint32_t palette[256] {};
+    for (int i = 1; i <= colors; ++i) {
+        const char *color { strstr(xpm[i] + 1, "c ") };
+        if (color)
+            palette[static_cast<unsigned char>(xpm[i][0])] = named_color(color + 2);
+    }
+
+    image.pixels.resize(image.width*image.height);
+    for (int y = 0; y < image.height; ++y) {
+        const char *row { xpm[1 + colors + y] };
+        for (int x = 0; x < image.width; ++x)
+            image.pixels[y*image.width + x] = palette[static_cast<unsigned char>(row[x])];
+    }
+
+    return image;
+}
+
+const font_image& font(font_color color)
+{
+    static const font_image white { decode_xpm(font_white) };
+    static const font_image green { decode_xpm(font_green) };
+    static const font_image red { decode_xpm(font_red) };
+    static const font_image yellow { decode_xpm(font_yellow) };
+
+    switch (color) {
+    case font_color::GREEN:
+        return green;
+    case font_color::RED:
+        return red;
+    case font_color::YELLOW:
+        return yellow;
+    default:
+        return white;
+    }
+}
+
+}
+
+image_target::image_target()
+{
+    clear();
+}
+
+void image_target::clear()
+{
+    std::fill(std::begin(m_pixels), std::end(m_pixels), BLACK);
+}
+
+void image_target::plot(int x, int y, uint32_t color)
+{
+    if (x >= 0 && x < SIZE && y >= 0 && y < SIZE)
+        m_pixels[y*SIZE + x] = color;
+}
+
+void image_target::draw_glyph(font_color color, int column, int row, int x, int y)
+{
+    const auto& image = font(color);
+
+    const int left { column*quote_renderer::GLYPH_WIDTH };
+    const int top { row*quote_renderer::GLYPH_HEIGHT };
+
+    for (int dy = 0; dy < quote_renderer::GLYPH_HEIGHT; ++dy) {
+        for (int dx = 0; dx < quote_renderer::GLYPH_WIDTH; ++dx)
+            plot(x + dx, y + dy, image.pixels[(top + dy)*image.width + left + dx]);
+    }
+}
+
+void image_target::draw_lines(const render_point *points, size_t count)
+{
+    // Bresenham between each pair, like a zero width X line
+
+    for (size_t i = 1; i < count; ++i) {
+        int x0 { points[i - 1].x }, y0 { points[i - 1].y };
+        const int x1 { points[i].x }, y1 { points[i].y };
+
+        const int dx { abs(x1 - x0) }, sx { x0 < x1 ? 1 : -1 };
+        const int dy { -abs(y1 - y0) }, sy { y0 < y1 ? 1 : -1 };
+        int error { dx + dy };
+
+        for (;;) {
+            plot(x0, y0, GRAPH);
+            if (x0 == x1 && y0 == y1)
+                break;
+            const int e2 { 2*error };
+            if (e2 >= dy) {
+                error += dy;
+                x0 += sx;
+            }
+            if (e2 <= dx) {
+                error += dx;
+                y0 += sy;
+            }
+        }
+    }
+}
+
+uint32_t image_target::pixel(int x, int y) const
+{
+    return m_pixels[y*SIZE + x];
+}
+
+const uint32_t *image_target::pixels() const
+{
+    return m_pixels;
+}
+
+bool image_target::operator==(const image_target& other) const
+{
+    return !memcmp(m_pixels, other.m_pixels, sizeof(m_pixels));
+}
+
+bool image_target::operator!=(const image_target& other) const
+{
+    return !(*this == other);
+}
+
+bool image_target::write_ppm(const std::string& path) const
+{
+    std::ofstream file { path, std::ios::binary };
+
+    file << "P6\n" << SIZE << " " << SIZE << "\n255\n";
+    for (auto pixel : m_pixels) {
+        const char rgb[] { static_cast<char>(pixel >> 16), static_cast<char>(pixel >> 8), static_cast<char>(pixel) };
+        file.write(rgb, sizeof(rgb));
+    }
+
+    return static_cast<bool>(file);
+}
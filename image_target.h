@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "quote_renderer.h"
+
+// Offscreen render backend: composes frames into memory with the same font pixmaps the
+// dockapp loads, so the renderer can be benchmarked and checked without a display.
+
+class image_target : public render_target
+{
+public:
+    image_target();
+
+    void clear() override;
+    void draw_glyph(font_color font, int column, int row, int x, int y) override;
+    void draw_lines(const render_point *points, size_t count) override;
+
+    // 0xRRGGBB
+    uint32_t pixel(int x, int y) const;
+    const uint32_t *pixels() const;
+
+    bool operator==(const image_target& other) const;
+    bool operator!=(const image_target& other) const;
+
+    // binary PPM, handy when a test fails
+    bool write_ppm(const std::string& path) const;
+
+    static const int SIZE = quote_renderer::WINDOW_SIZE;
+
+private:
+    void plot(int x, int y, uint32_t color);
+
+    uint32_t m_pixels[SIZE*SIZE];
+};
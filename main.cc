@@ -1,53 +1,98 @@
-#include <unistd.h>
-
 #include <cstdlib>
-#include <iostream>
-#include <vector>
+#include <cstring>
 
 #include <curl/curl.h>
 
-#include <boost/property_tree/ptree.hpp>
-#include <boost/property_tree/json_parser.hpp>
-
+#include "config.h"
+#include "quote_engine.h"
+#include "quote_stream.h"
 #include "wm_window.h"
 
 int
 main(int argc, char *argv[])
 {
-    int update_interval;
-    std::vector<std::string> quotes;
-
-    auto rc_path = std::string { std::getenv("HOME") } + "/.wmibov";
-
-    if (access(rc_path.c_str(), R_OK) == 0) {
-        boost::property_tree::ptree tree;
-        boost::property_tree::read_json(rc_path, tree);
-
-        update_interval = tree.get<int>("interval", 30);
-
-        const auto& symbols = tree.get_child("symbols");
-        std::transform(
-                std::begin(symbols),
-                std::end(symbols),
-                std::back_inserter(quotes),
-                [](const boost::property_tree::ptree::value_type& v)
-                { return v.second.data(); });
-    } else {
-        quotes = { "BVSP" };
-        update_interval = 30;
+    // --headless [--output PATH] streams quotes as JSON lines instead of opening a window;
+    // --record PATH saves every response, --replay PATH [--speed N] plays them back instead
+    // of fetching, N times as fast as recorded or as fast as possible with 0
+
+    bool headless { false };
+    std::string output { "-" };
+    std::string record;
+    std::string replay;
+    double speed { 1 };
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--headless") == 0)
+            headless = true;
+        else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc)
+            output = argv[++i];
+        else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc)
+            record = argv[++i];
+        else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc)
+            replay = argv[++i];
+        else if (strcmp(argv[i], "--speed") == 0 && i + 1 < argc)
+            speed = atof(argv[++i]);
     }
 
+    config conf;
+    load_config(config_path(), conf);
+
     curl_global_init(CURL_GLOBAL_ALL);
 
-    wm_window window;
+    {
+        quote_engine engine;
+
+        bool ready { engine.initialize() };
+
+        if (ready) {
+            // a replay stands alone: nothing from the cache, bus, stream or a config reload
+
+            if (replay.empty())
+                engine.load_cache(config_path() + ".cache");
+
+            if (conf.providers.empty())
+                conf.providers.push_back(provider_config { "default", conf.quote_url, quote_fields {} });
+
+            for (const auto& provider : conf.providers)
+                engine.add_provider(std::unique_ptr<quote_provider> { new json_quote_provider { provider.name, provider.url, provider.fields } });
+
+            engine.set_history_size(conf.history_size);
+
+            if (conf.stats)
+                engine.enable_stats(conf.stats_file, conf.stats_interval);
+
+            if (!replay.empty()) {
+                ready = engine.enable_replay(replay, speed);
+            } else {
+                if (conf.shared)
+                    engine.enable_bus(conf.bus_name);
+
+                if (!conf.stream.url.empty())
+                    engine.enable_stream(conf.stream, conf.connect_timeout, conf.timeout);
+            }
 
-    if (window.initialize(argc, argv)) {
-        window.set_update_interval(update_interval);
+            if (!record.empty())
+                engine.record(record);
+        }
 
-        for (const auto& quote : quotes)
-            window.add_quote(quote);
+        if (ready) {
+            // the rest can change while running
+            engine.configure(conf);
+            if (replay.empty())
+                engine.watch_config(config_path());
 
-        window.run();
+            if (headless) {
+                quote_stream stream { engine };
+                if (stream.open(output))
+                    stream.run();
+            } else {
+                wm_window window { engine };
+                if (window.initialize(argc, argv)) {
+                    window.set_verbose(conf.verbose);
+                    window.run();
+                }
+            }
+        }
     }
 
     curl_global_cleanup();
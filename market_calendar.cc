@@ -0,0 +1,121 @@
+#include <cstdio>
+
+#include "market_calendar.h"
+
+namespace {
+
+const long SECONDS_PER_DAY { 24*60*60 };
+
+// days since 1970-01-01 for a proleptic gregorian date
+long days_from_civil(int year, int month, int day)
+{
+    year -= month <= 2;
+    const long era { (year >= 0 ? year : year - 399)/400 };
+    const long year_of_era { year - era*400 };
+    const long day_of_year { (153*(month + (month > 2 ? -3 : 9)) + 2)/5 + day - 1 };
+    const long day_of_era { year_of_era*365 + year_of_era/4 - year_of_era/100 + day_of_year };
+    return era*146097 + day_of_era - 719468;
+}
+
+long floor_div(long a, long b)
+{
+    return a/b - (a%b != 0 && (a < 0) != (b < 0));
+}
+
+}
+
+market_calendar::market_calendar()
+    : m_open_minute { 10*60 }
+    , m_close_minute { 18*60 }
+    , m_utc_offset { -3*60 }
+    , m_weekdays { 0x3e } // monday through friday
+    , m_always_open { false }
+{
+}
+
+void market_calendar::set_session(int open_minute, int close_minute)
+{
+    m_open_minute = open_minute;
+    m_close_minute = close_minute;
+}
+
+void market_calendar::set_utc_offset(int minutes)
+{
+    m_utc_offset = minutes;
+}
+
+void market_calendar::set_weekdays(unsigned weekday_mask)
+{
+    m_weekdays = weekday_mask;
+}
+
+void market_calendar::add_holiday(int year, int month, int day)
+{
+    m_holidays.insert(days_from_civil(year, month, day));
+}
+
+void market_calendar::set_always_open(bool always_open)
+{
+    m_always_open = always_open;
+}
+
+bool market_calendar::is_trading_day(long day) const
+{
+    // 1970-01-01 was a thursday
+    const int weekday { static_cast<int>(((day + 4)%7 + 7)%7) };
+    return (m_weekdays & (1u << weekday)) && !m_holidays.count(day);
+}
+
+long market_calendar::local_day(time_t t) const
+{
+    return floor_div(static_cast<long>(t) + m_utc_offset*60l, SECONDS_PER_DAY);
+}
+
+bool market_calendar::is_open(time_t t) const
+{
+    if (m_always_open)
+        return true;
+
+    const long local { static_cast<long>(t) + m_utc_offset*60l };
+    const long day { floor_div(local, SECONDS_PER_DAY) };
+    const long minute { (local - day*SECONDS_PER_DAY)/60 };
+
+    return is_trading_day(day) && minute >= m_open_minute && minute < m_close_minute;
+}
+
+time_t market_calendar::next_open(time_t t) const
+{
+    if (is_open(t))
+        return t;
+
+    const long local { static_cast<long>(t) + m_utc_offset*60l };
+    long day { floor_div(local, SECONDS_PER_DAY) };
+
+    if ((local - day*SECONDS_PER_DAY)/60 >= m_open_minute)
+        ++day;
+
+    // a year of holidays and weekends is plenty; give up on a calendar with no trading days
+    for (int i = 0; i < 366; ++i, ++day) {
+        if (is_trading_day(day))
+            return day*SECONDS_PER_DAY + m_open_minute*60l - m_utc_offset*60l;
+    }
+
+    return t + SECONDS_PER_DAY;
+}
+
+bool market_calendar::parse_time(const std::string& text, int& minute)
+{
+    int hours, minutes;
+    char tail;
+    if (sscanf(text.c_str(), "%d:%d%c", &hours, &minutes, &tail) != 2 || hours < 0 || hours > 24 || minutes < 0 || minutes > 59)
+        return false;
+    minute = hours*60 + minutes;
+    return true;
+}
+
+bool market_calendar::parse_date(const std::string& text, int& year, int& month, int& day)
+{
+    char tail;
+    return sscanf(text.c_str(), "%d-%d-%d%c", &year, &month, &day, &tail) == 3 &&
+           month >= 1 && month <= 12 && day >= 1 && day <= 31;
+}
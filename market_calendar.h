@@ -0,0 +1,39 @@
+#pragma once
+
+#include <ctime>
+#include <set>
+#include <string>
+
+// Trading session of a single exchange: one session per trading day, in exchange local time
+// given as a fixed offset from UTC, on the configured weekdays except holidays.
+
+class market_calendar
+{
+public:
+    market_calendar();
+
+    void set_session(int open_minute, int close_minute);
+    void set_utc_offset(int minutes);
+    void set_weekdays(unsigned weekday_mask);
+    void add_holiday(int year, int month, int day);
+    void set_always_open(bool always_open);
+
+    bool is_open(time_t t) const;
+
+    // days since the epoch in exchange local time
+    long local_day(time_t t) const;
+    time_t next_open(time_t t) const;
+
+    static bool parse_time(const std::string& text, int& minute);
+    static bool parse_date(const std::string& text, int& year, int& month, int& day);
+
+private:
+    bool is_trading_day(long day) const;
+
+    int m_open_minute;
+    int m_close_minute;
+    int m_utc_offset;
+    unsigned m_weekdays;
+    bool m_always_open;
+    std::set<long> m_holidays;
+};
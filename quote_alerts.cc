@@ -0,0 +1,154 @@
+#include <algorithm>
+#include <iostream>
+
+#include "quote_alerts.h"
+
+quote_alerts::quote_alerts()
+    : m_offsets(quote_table::MAX_QUOTES*VALUES*DIRECTIONS + 1, 0)
+    , m_state(quote_table::MAX_QUOTES)
+{
+}
+
+void quote_alerts::set_market(const market_calendar& market)
+{
+    m_market = market;
+}
+
+size_t quote_alerts::list(quote_id id, int value, int direction)
+{
+    return (id*VALUES + value)*DIRECTIONS + direction;
+}
+
+void quote_alerts::set_rules(const std::vector<alert_config>& rules, const quote_table& quotes)
+{
+    struct entry
+    {
+        size_t list;
+        threshold t;
+    };
+
+    std::vector<entry> entries;
+
+    m_rules.clear();
+
+    for (const auto& rule : rules) {
+        quote_id id;
+        if (!quotes.find(rule.symbol, id)) {
+            std::cerr << "alert for " << rule.symbol << ", which isn't watched, ignoring\n";
+            continue;
+        }
+
+        const uint32_t index = m_rules.size();
+        m_rules.push_back(rule);
+
+        // the moves are watched both ways
+        const decimal level { rule.level < decimal {} ? -rule.level : rule.level };
+
+        switch (rule.kind) {
+        case alert_kind::ABOVE:
+            entries.push_back({ list(id, LAST, RISING), { rule.level, index } });
+            break;
+
+        case alert_kind::BELOW:
+            entries.push_back({ list(id, LAST, FALLING), { rule.level, index } });
+            break;
+
+        case alert_kind::PERCENT_MOVE:
+            entries.push_back({ list(id, PERCENT_CHANGE, RISING), { level, index } });
+            entries.push_back({ list(id, PERCENT_CHANGE, FALLING), { -level, index } });
+            break;
+
+        case alert_kind::MOVE_SINCE_OPEN:
+            entries.push_back({ list(id, SINCE_OPEN, RISING), { level, index } });
+            entries.push_back({ list(id, SINCE_OPEN, FALLING), { -level, index } });
+            break;
+        }
+    }
+
+    std::sort(std::begin(entries), std::end(entries), [](const entry& a, const entry& b) {
+        return a.list != b.list ? a.list < b.list : a.t.level < b.t.level;
+    });
+
+    m_thresholds.clear();
+    std::fill(std::begin(m_offsets), std::end(m_offsets), 0);
+
+    for (const auto& e : entries) {
+        m_thresholds.push_back(e.t);
+        ++m_offsets[e.list + 1];
+    }
+
+    for (size_t i = 1; i < m_offsets.size(); ++i)
+        m_offsets[i] += m_offsets[i - 1];
+}
+
+const alert_config& quote_alerts::rule(uint32_t index) const
+{
+    return m_rules[index];
+}
+
+size_t quote_alerts::size() const
+{
+    return m_rules.size();
+}
+
+void quote_alerts::update(quote_id id, time_t now, decimal last, decimal percent_change, std::vector<fired>& fired)
+{
+    auto& state = m_state[id];
+
+    // the first price of the session is its open; the move since the previous one is no
+    // baseline for this one
+    if (m_market.is_open(now)) {
+        const long day { m_market.local_day(now) };
+        if (day != state.open_day) {
+            state.open_day = day;
+            state.open = last;
+            state.seen[SINCE_OPEN] = false;
+        }
+    }
+
+    check(id, LAST, last, fired);
+    check(id, PERCENT_CHANGE, percent_change, fired);
+
+    if (state.open_day != -1)
+        check(id, SINCE_OPEN, last - state.open, fired);
+}
+
+void quote_alerts::check(quote_id id, int value, decimal current, std::vector<fired>& fired)
+{
+    auto& state = m_state[id];
+
+    const decimal previous { state.value[value] };
+    const bool seen { state.seen[value] };
+
+    state.value[value] = current;
+    state.seen[value] = true;
+
+    if (!seen || current == previous)
+        return;
+
+    const bool rising { current > previous };
+    const size_t l { list(id, value, rising ? RISING : FALLING) };
+
+    const threshold *begin { m_thresholds.data() + m_offsets[l] };
+    const threshold *end { m_thresholds.data() + m_offsets[l + 1] };
+
+    if (begin == end)
+        return;
+
+    const auto below = [](decimal v, const threshold& t) { return v < t.level; };
+    const auto above = [](const threshold& t, decimal v) { return t.level < v; };
+
+    // going up crosses the levels in (previous, current], going down those in [current, previous)
+
+    const threshold *first, *last;
+    if (rising) {
+        first = std::upper_bound(begin, end, previous, below);
+        last = std::upper_bound(first, end, current, below);
+    } else {
+        first = std::lower_bound(begin, end, current, above);
+        last = std::lower_bound(first, end, previous, above);
+    }
+
+    for (const threshold *t = first; t != last; ++t)
+        fired.push_back({ id, t->rule, current });
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <ctime>
+#include <cstdint>
+#include <vector>
+
+#include "config.h"
+#include "decimal.h"
+#include "market_calendar.h"
+#include "quote_table.h"
+
+// Alert rules indexed by quote, so that checking an update costs a few binary searches plus
+// whatever fires, however many rules there are. Each quote has three watched values: the
+// last price, the percent change and the move since the session opened, and each of those
+// has its levels sorted once for crossing upwards and once for crossing downwards. A rule
+// fires when an update crosses its level; the first value seen only sets the baseline.
+//
+// The session open is the first price seen after the market opened that day.
+
+class quote_alerts
+{
+public:
+    struct fired
+    {
+        quote_id id;
+        uint32_t rule;
+        decimal value; // the value that crossed the level
+    };
+
+    quote_alerts();
+
+    void set_market(const market_calendar& market);
+
+    // rules for symbols not in the table are skipped; the values seen so far are kept
+    void set_rules(const std::vector<alert_config>& rules, const quote_table& quotes);
+
+    const alert_config& rule(uint32_t index) const;
+    size_t size() const;
+
+    // appends the rules the new values crossed
+    void update(quote_id id, time_t now, decimal last, decimal percent_change, std::vector<fired>& fired);
+
+private:
+    enum { LAST, PERCENT_CHANGE, SINCE_OPEN, VALUES };
+    enum { RISING, FALLING, DIRECTIONS };
+
+    struct threshold
+    {
+        decimal level;
+        uint32_t rule;
+    };
+
+    struct quote_state
+    {
+        decimal value[VALUES];
+        bool seen[VALUES] {};
+        decimal open;
+        long open_day = -1;
+    };
+
+    static size_t list(quote_id id, int value, int direction);
+
+    void check(quote_id id, int value, decimal current, std::vector<fired>& fired);
+
+    std::vector<alert_config> m_rules;
+
+    // the levels of each list, ascending, are m_thresholds[m_offsets[list]] up to
+    // m_offsets[list + 1]
+    std::vector<threshold> m_thresholds;
+    std::vector<uint32_t> m_offsets;
+
+    // preallocated, like the snapshots, so that quotes can be added while fetching
+    std::vector<quote_state> m_state;
+
+    market_calendar m_market;
+};
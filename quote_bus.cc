@@ -0,0 +1,241 @@
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <iostream>
+
+#include "quote_bus.h"
+
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "futex word must be a plain 32-bit int");
+
+quote_bus::~quote_bus()
+{
+    if (m_header)
+        munmap(m_header, sizeof(header));
+
+    if (m_fd != -1)
+        close(m_fd);
+}
+
+bool quote_bus::open(const std::string& name)
+{
+    // one segment per user, which only they can touch: whoever can write it decides what
+    // quotes the instances see and so when their alert commands run
+
+    const std::string path { name + "-" + std::to_string(geteuid()) };
+
+    m_fd = shm_open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (m_fd == -1) {
+        std::cerr << "failed to open quote bus " << path << "\n";
+        return false;
+    }
+
+    // a fresh segment is all zeroes, which is an empty table with every seqlock at rest
+
+    struct stat st;
+    if (fstat(m_fd, &st) == -1 || st.st_uid != geteuid() || (st.st_mode & (S_IRWXG | S_IRWXO))) {
+        std::cerr << "quote bus " << path << " isn't private to this user\n";
+        close(m_fd);
+        m_fd = -1;
+        return false;
+    }
+
+    if (st.st_size != 0 && static_cast<size_t>(st.st_size) != sizeof(header)) {
+        std::cerr << "quote bus " << path << " has an incompatible layout\n";
+        close(m_fd);
+        m_fd = -1;
+        return false;
+    }
+
+    if (st.st_size == 0 && ftruncate(m_fd, sizeof(header)) == -1) {
+        std::cerr << "failed to resize quote bus " << path << "\n";
+        close(m_fd);
+        m_fd = -1;
+        return false;
+    }
+
+    void *data { mmap(nullptr, sizeof(header), PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0) };
+    if (data == MAP_FAILED) {
+        std::cerr << "failed to map quote bus " << path << "\n";
+        close(m_fd);
+        m_fd = -1;
+        return false;
+    }
+
+    m_header = static_cast<header *>(data);
+
+    // instances built with a different value format must not read each other's quotes
+
+    uint32_t layout { 0 };
+    if (!m_header->layout.compare_exchange_strong(layout, LAYOUT) && layout != LAYOUT) {
+        std::cerr << "quote bus " << path << " has an incompatible layout\n";
+        munmap(m_header, sizeof(header));
+        m_header = nullptr;
+        close(m_fd);
+        m_fd = -1;
+        return false;
+    }
+
+    return true;
+}
+
+bool quote_bus::is_open() const
+{
+    return m_header != nullptr;
+}
+
+uint32_t quote_bus::clamped_size(std::memory_order order) const
+{
+    const uint32_t size { m_header->size.load(order) };
+    return size < CAPACITY ? size : CAPACITY;
+}
+
+bool quote_bus::lock(short start, bool wait) const
+{
+    struct flock fl {};
+    fl.l_type = F_WRLCK;
+    fl.l_whence = SEEK_SET;
+    fl.l_start = start;
+    fl.l_len = 1;
+
+    while (fcntl(m_fd, wait ? F_OFD_SETLKW : F_OFD_SETLK, &fl) == -1) {
+        if (errno != EINTR)
+            return false;
+    }
+
+    return true;
+}
+
+void quote_bus::unlock(short start) const
+{
+    struct flock fl {};
+    fl.l_type = F_UNLCK;
+    fl.l_whence = SEEK_SET;
+    fl.l_start = start;
+    fl.l_len = 1;
+
+    fcntl(m_fd, F_OFD_SETLK, &fl);
+}
+
+bool quote_bus::try_lead()
+{
+    if (m_leader)
+        return true;
+
+    if (!m_header || !lock(0, false))
+        return false;
+
+    // the previous leader may have died halfway through a publish
+
+    const uint32_t size { clamped_size(std::memory_order_acquire) };
+    for (uint32_t i = 0; i < size; ++i)
+        m_header->slots[i].value.recover();
+
+    m_leader = true;
+    return true;
+}
+
+bool quote_bus::leader() const
+{
+    return m_leader;
+}
+
+int quote_bus::subscribe(const std::string& symbol)
+{
+    if (!m_header || symbol.empty() || symbol.size() >= sizeof(slot::symbol))
+        return -1;
+
+    if (!lock(1, true))
+        return -1;
+
+    int found { -1 };
+
+    const uint32_t size { clamped_size(std::memory_order_relaxed) };
+
+    for (uint32_t i = 0; i < size; ++i) {
+        if (strncmp(m_header->slots[i].symbol, symbol.c_str(), sizeof(slot::symbol)) == 0) {
+            found = i;
+            break;
+        }
+    }
+
+    if (found == -1 && size < CAPACITY) {
+        auto& s = m_header->slots[size];
+        memset(s.symbol, 0, sizeof(s.symbol));
+        strncpy(s.symbol, symbol.c_str(), sizeof(s.symbol) - 1);
+
+        // the leader picks up new symbols by watching size, so publish it last
+        m_header->size.store(size + 1, std::memory_order_release);
+        found = size;
+    }
+
+    unlock(1);
+
+    return found;
+}
+
+uint32_t quote_bus::size() const
+{
+    if (!m_header || m_header->layout.load(std::memory_order_relaxed) != LAYOUT)
+        return 0;
+
+    return clamped_size(std::memory_order_acquire);
+}
+
+bool quote_bus::symbol(int index, std::string& symbol) const
+{
+    // a plain printable name, NUL-terminated within the slot
+
+    const auto& s = m_header->slots[index];
+    const size_t length { strnlen(s.symbol, sizeof(s.symbol)) };
+    if (length == 0 || length == sizeof(s.symbol))
+        return false;
+
+    for (size_t i = 0; i < length; ++i) {
+        if (s.symbol[i] <= ' ' || s.symbol[i] > '~')
+            return false;
+    }
+
+    symbol.assign(s.symbol, length);
+    return true;
+}
+
+void quote_bus::publish(int slot, const quote& q)
+{
+    m_header->slots[slot].value.store(q);
+    m_header->generation.fetch_add(1, std::memory_order_release);
+    wake();
+}
+
+bool quote_bus::read(int slot, quote& q) const
+{
+    if (!m_header->slots[slot].value.try_load(q))
+        return false;
+
+    return q.status == quote_status::NONE || q.status == quote_status::FETCHED || q.status == quote_status::ERROR;
+}
+
+uint32_t quote_bus::generation() const
+{
+    return m_header->generation.load(std::memory_order_acquire);
+}
+
+void quote_bus::wake()
+{
+    syscall(SYS_futex, reinterpret_cast<uint32_t *>(&m_header->generation), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+}
+
+void quote_bus::wait(uint32_t generation, int timeout_ms) const
+{
+    timespec timeout;
+    timeout.tv_sec = timeout_ms/1000;
+    timeout.tv_nsec = (timeout_ms%1000)*1000000l;
+
+    syscall(SYS_futex, reinterpret_cast<uint32_t *>(&m_header->generation), FUTEX_WAIT, generation, &timeout, nullptr, 0);
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <ctime>
+#include <string>
+
+#include <boost/core/noncopyable.hpp>
+
+#include "seqlock.h"
+#include "quote_table.h"
+
+// POSIX shared-memory table through which the instances on a host share one upstream
+// poller. Whoever holds the leader lock fetches every symbol any instance subscribed to and
+// publishes the results; the rest only read. Each slot is a seqlock, so readers never block
+// the leader, and a futex on the generation counter wakes readers after each publish.
+//
+// Both locks are OFD locks on the segment itself, so they go away with the process that
+// held them: byte 0 is the leader lock, byte 1 serializes subscriptions.
+//
+// The segment is per user and private to them, since its quotes fire alert commands. Still,
+// nothing read from it is trusted: the size is clamped to the capacity, and slots holding
+// anything but a plain symbol or a known status are skipped.
+
+class quote_bus : private boost::noncopyable
+{
+public:
+    struct quote
+    {
+        int64_t last; // decimal units
+        int64_t change;
+        int64_t percent_change;
+        int64_t last_update;
+        uint32_t serial; // bumped on every publish, including unchanged and failed fetches
+        quote_status status;
+    };
+
+    static const uint32_t CAPACITY = 256;
+
+    quote_bus() = default;
+    ~quote_bus();
+
+    bool open(const std::string& name);
+    bool is_open() const;
+
+    // non-blocking; once it succeeds this process stays the leader until it exits
+    bool try_lead();
+    bool leader() const;
+
+    // slot for the symbol, claiming a new one if needed; -1 if the table is full
+    int subscribe(const std::string& symbol);
+    uint32_t size() const; // never more than CAPACITY, 0 if the layout changed underneath
+    bool symbol(int slot, std::string& symbol) const; // false if the slot is garbage
+
+    void publish(int slot, const quote& q);
+    bool read(int slot, quote& q) const;
+
+    uint32_t generation() const;
+    void wake();
+    void wait(uint32_t generation, int timeout_ms) const;
+
+private:
+    struct slot
+    {
+        char symbol[16];
+        seqlock<quote> value;
+    };
+
+    struct header
+    {
+        std::atomic<uint32_t> generation; // futex word
+        std::atomic<uint32_t> size;
+        std::atomic<uint32_t> layout; // LAYOUT, set by whoever maps the segment first
+        slot slots[CAPACITY];
+    };
+
+    static const uint32_t LAYOUT = 2;
+
+    uint32_t clamped_size(std::memory_order order) const;
+    bool lock(short start, bool wait) const;
+    void unlock(short start) const;
+
+    header *m_header = nullptr;
+    int m_fd = -1;
+    std::atomic<bool> m_leader { false };
+};
@@ -0,0 +1,104 @@
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <iostream>
+
+#include "quote_cache.h"
+
+namespace {
+const char cache_magic[8] { 'w', 'm', 'i', 'b', 'o', 'v', 'c', '\0' };
+}
+
+quote_cache::~quote_cache()
+{
+    if (m_header)
+        munmap(m_header, m_size);
+}
+
+bool quote_cache::open(const std::string& path)
+{
+    const int fd { ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644) };
+    if (fd == -1) {
+        std::cerr << "failed to open quote cache " << path << "\n";
+        return false;
+    }
+
+    m_size = sizeof(header) + CAPACITY*sizeof(record);
+
+    struct stat st;
+    if (fstat(fd, &st) == -1 || static_cast<size_t>(st.st_size) != m_size) {
+        if (ftruncate(fd, m_size) == -1) {
+            std::cerr << "failed to resize quote cache " << path << "\n";
+            close(fd);
+            return false;
+        }
+    }
+
+    void *data { mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) };
+    close(fd);
+
+    if (data == MAP_FAILED) {
+        std::cerr << "failed to map quote cache " << path << "\n";
+        return false;
+    }
+
+    m_header = static_cast<header *>(data);
+    m_records = reinterpret_cast<record *>(m_header + 1);
+
+    if (memcmp(m_header->magic, cache_magic, sizeof(cache_magic)) != 0 || m_header->version != VERSION || m_header->capacity != CAPACITY) {
+        memset(data, 0, m_size);
+        memcpy(m_header->magic, cache_magic, sizeof(cache_magic));
+        m_header->version = VERSION;
+        m_header->capacity = CAPACITY;
+    }
+
+    return true;
+}
+
+int quote_cache::slot(const std::string& symbol)
+{
+    if (!m_header || symbol.empty() || symbol.size() >= sizeof(record::symbol))
+        return -1;
+
+    int free_slot { -1 };
+
+    for (uint32_t i = 0; i < CAPACITY; ++i) {
+        const auto& r = m_records[i];
+        if (r.symbol[0] == '\0') {
+            if (free_slot == -1)
+                free_slot = i;
+        } else if (strncmp(r.symbol, symbol.c_str(), sizeof(r.symbol)) == 0) {
+            return i;
+        }
+    }
+
+    if (free_slot != -1) {
+        auto& r = m_records[free_slot];
+        memset(&r, 0, sizeof(r));
+        strncpy(r.symbol, symbol.c_str(), sizeof(r.symbol) - 1);
+    }
+
+    return free_slot;
+}
+
+const quote_cache::record *quote_cache::get(int slot) const
+{
+    if (slot < 0)
+        return nullptr;
+    return &m_records[slot];
+}
+
+void quote_cache::store(int slot, time_t last_update, decimal last, decimal change, decimal percent_change)
+{
+    if (slot < 0)
+        return;
+
+    auto& r = m_records[slot];
+    r.last = last.units();
+    r.change = change.units();
+    r.percent_change = percent_change.units();
+    r.last_update = last_update;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <ctime>
+#include <cstdint>
+#include <string>
+
+#include <boost/core/noncopyable.hpp>
+
+#include "decimal.h"
+
+// Fixed-size memory-mapped file holding the last known values of every symbol we've seen,
+// so that a fresh start has something to show before the network answers. Records are
+// claimed once per symbol and then overwritten in place on each update.
+
+class quote_cache : private boost::noncopyable
+{
+public:
+    struct record
+    {
+        char symbol[16];
+        int64_t last_update;
+        int64_t last; // decimal units
+        int64_t change;
+        int64_t percent_change;
+    };
+
+    quote_cache() = default;
+    ~quote_cache();
+
+    bool open(const std::string& path);
+    int slot(const std::string& symbol);
+    const record *get(int slot) const;
+    void store(int slot, time_t last_update, decimal last, decimal change, decimal percent_change);
+
+private:
+    struct header
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t capacity;
+    };
+
+    static const uint32_t VERSION = 2;
+    static const uint32_t CAPACITY = 1024;
+
+    header *m_header = nullptr;
+    record *m_records = nullptr;
+    size_t m_size = 0;
+};
@@ -0,0 +1,909 @@
+#include <sys/timerfd.h>
+#include <sys/signalfd.h>
+#include <sys/wait.h>
+#include <signal.h>
+#include <spawn.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <fstream>
+#include <string>
+
+#include "quote_engine.h"
+#include "quote_fetcher.h"
+
+namespace {
+
+sigset_t handled_signals()
+{
+    // SIGUSR1 dumps stats, SIGINT and SIGTERM stop the main loop
+
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGUSR1);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGTERM);
+    return mask;
+}
+
+time_t timer_clock_now()
+{
+    // time() reads the coarse clock, which can still be on the previous second when the
+    // timer fires on the dot; the loop would then find nothing due and spin until it ticks
+
+    timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    return now.tv_sec;
+}
+
+// as in the config
+const char *alert_kind_name(alert_kind kind)
+{
+    switch (kind) {
+    case alert_kind::ABOVE:
+        return "above";
+    case alert_kind::BELOW:
+        return "below";
+    case alert_kind::PERCENT_MOVE:
+        return "percent_move";
+    case alert_kind::MOVE_SINCE_OPEN:
+        return "move_since_open";
+    }
+    return "unknown";
+}
+
+}
+
+quote_engine::quote_engine()
+{
+    // signals are read from a signalfd in the main loop; block them before the fetcher
+    // thread starts so that it inherits the mask
+
+    const sigset_t mask { handled_signals() };
+    pthread_sigmask(SIG_BLOCK, &mask, nullptr);
+
+    // indexed by the fetcher thread, so never reallocated
+    m_cache_slots.reserve(quote_table::MAX_QUOTES);
+    m_bus_slots.reserve(quote_table::MAX_QUOTES);
+
+    m_quote_fetcher.reset(new quote_fetcher { *this });
+}
+
+quote_engine::~quote_engine()
+{
+    // both call back into us, so they go first
+    stop_bus_reader();
+    m_feed.reset();
+    m_quote_fetcher.reset();
+
+    if (m_timer_fd != -1)
+        close(m_timer_fd);
+
+    if (m_signal_fd != -1)
+        close(m_signal_fd);
+
+    for (auto fd : m_completed_fds) {
+        if (fd != -1)
+            close(fd);
+    }
+}
+
+bool quote_engine::initialize()
+{
+    // the fetcher, feed and bus reader threads, and the watchdog on this one, write the id
+    // of each updated quote here; ids are coalesced until read, so the pipe holds at most one
+    // per quote plus the end of a replay, far less than it can take, and writes never block
+
+    if (pipe2(m_completed_fds, O_CLOEXEC | O_NONBLOCK) == -1) {
+        std::cerr << "failed to create completion pipe\n";
+        return false;
+    }
+
+    m_timer_fd = timerfd_create(CLOCK_REALTIME, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (m_timer_fd == -1) {
+        std::cerr << "failed to create timer fd\n";
+        return false;
+    }
+
+    const sigset_t mask { handled_signals() };
+
+    m_signal_fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (m_signal_fd == -1) {
+        std::cerr << "failed to create signal fd\n";
+        return false;
+    }
+
+    return true;
+}
+
+bool quote_engine::load_cache(const std::string& path)
+{
+    return m_cache.open(path);
+}
+
+bool quote_engine::add_quote(const std::string& symbol, bool hidden, quote_id& id)
+{
+    if (m_quotes.find(symbol, id)) {
+        // asked for locally after being picked up from the bus or dropped from the config
+        if (!hidden)
+            m_quotes.hidden[id] = m_quotes.removed[id] = 0;
+        return true;
+    }
+
+    if (!m_quotes.add(symbol, id))
+        return false;
+
+    m_quotes.hidden[id] = hidden;
+    m_quote_fetcher->add_quote(id, symbol);
+    if (m_feed)
+        m_feed->add_quote(id, symbol);
+
+    m_history.add_quote();
+    if (m_stats)
+        m_stats->add_quote();
+
+    m_bus_slots.push_back(m_bus.is_open() ? m_bus.subscribe(symbol) : -1);
+
+    // show the last known values until the first fetch comes back; other instances'
+    // symbols stay out of our cache
+
+    m_cache_slots.push_back(hidden ? -1 : m_cache.slot(symbol));
+
+    const auto record = m_cache.get(m_cache_slots[id]);
+    if (record && record->last_update != 0) {
+        quote_snapshot quote;
+        quote.last = decimal::from_units(record->last);
+        quote.change = decimal::from_units(record->change);
+        quote.percent_change = decimal::from_units(record->percent_change);
+        quote.last_update = record->last_update;
+        quote.stale = true;
+        format_quote(quote.last, quote.change, quote.percent_change, quote.text);
+        m_quotes.snapshot[id].store(quote);
+    }
+
+    return true;
+}
+
+void quote_engine::add_provider(std::unique_ptr<quote_provider> provider)
+{
+    m_quote_fetcher->add_provider(std::move(provider));
+}
+
+void quote_engine::set_history_size(size_t history_size)
+{
+    m_history.set_capacity(history_size);
+}
+
+void quote_engine::enable_stats(const std::string& path, time_t interval)
+{
+    // must come before configure, stats are kept per quote
+    if (!m_quotes.size()) {
+        m_stats.reset(new fetch_stats);
+        m_stats_path = path;
+        m_stats_interval = interval;
+        m_quote_fetcher->set_stats(m_stats.get());
+    }
+}
+
+bool quote_engine::enable_bus(const std::string& name)
+{
+    if (m_quotes.size())
+        return false;
+    return m_bus.open(name);
+}
+
+bool quote_engine::enable_stream(const stream_config& stream, long connect_timeout, long stall_timeout)
+{
+    if (m_quotes.size() || stream.url.empty())
+        return false;
+
+    std::unique_ptr<quote_feed> feed { new quote_feed { *this, stream.url, stream.symbol_key, stream.fields } };
+    if (!feed->initialize())
+        return false;
+
+    feed->set_timeouts(connect_timeout, stall_timeout);
+    feed->set_stats(m_stats.get());
+    m_feed = std::move(feed);
+    return true;
+}
+
+void quote_engine::configure(const config& conf)
+{
+    refresh_policy policy;
+    policy.set_update_interval(conf.update_interval);
+    policy.set_min_interval(conf.min_interval);
+    policy.set_closed_interval(conf.closed_interval);
+    policy.set_retry_interval(conf.retry_interval);
+    policy.set_max_backoff(conf.max_backoff);
+    policy.set_spread_updates(conf.spread_updates);
+    policy.set_market(conf.market);
+    m_policy = policy;
+
+    m_quote_fetcher->set_max_requests(conf.max_requests);
+    m_quote_fetcher->set_timeouts(conf.connect_timeout, conf.timeout);
+    m_timeout = conf.timeout;
+
+    if (m_replaying) {
+        set_alerts(conf);
+        return;
+    }
+
+    const time_t now { time(nullptr) };
+    const size_t known { m_quotes.size() };
+
+    std::vector<uint8_t> listed(known, 0);
+
+    for (const auto& symbol : conf.symbols) {
+        quote_id id;
+        const bool existed { m_quotes.find(symbol, id) };
+        const bool shown { existed && !m_quotes.hidden[id] };
+
+        if (!add_quote(symbol, false, id)) {
+            std::cerr << "too many quotes, ignoring " << symbol << "\n";
+            continue;
+        }
+
+        if (id < known)
+            listed[id] = 1;
+
+        if (!shown && m_started) {
+            m_reconfigured.push_back(id);
+            if (!m_quotes.pending[id])
+                schedule(id, now);
+        }
+    }
+
+    // dropped symbols keep their row, history and cache slot in case they come back; a leader
+    // still fetches the ones other instances subscribed to
+
+    for (quote_id id = 0; id < known; ++id) {
+        if (listed[id] || m_quotes.hidden[id])
+            continue;
+
+        m_quotes.hidden[id] = 1;
+        m_quotes.removed[id] = 1;
+        m_reconfigured.push_back(id);
+
+        if (m_bus_slots[id] != -1 && m_bus.leader())
+            continue;
+
+        m_scheduler.cancel(id);
+
+        if (m_quotes.pending[id]) {
+            m_quote_fetcher->cancel(id);
+            m_quotes.pending[id] = 0;
+            m_quotes.overdue[id] = 0;
+        }
+    }
+
+    // a follower's reader only knows the quotes it started with
+    if (m_bus_reader.joinable() && m_quotes.size() > known) {
+        stop_bus_reader();
+        start_bus_reader(m_quotes.size());
+    }
+
+    set_alerts(conf);
+}
+
+void quote_engine::set_alerts(const config& conf)
+{
+    std::unique_lock<std::mutex> lock { m_sink_mutex };
+
+    m_alerts.set_market(conf.market);
+    m_alerts.set_rules(conf.alerts, m_quotes);
+
+    // these refer to the old rules by index
+    m_fired.clear();
+}
+
+bool quote_engine::record(const std::string& path)
+{
+    return m_quote_fetcher->record(path);
+}
+
+bool quote_engine::enable_replay(const std::string& path, double speed)
+{
+    if (m_quotes.size() || !m_replay_log.open(path))
+        return false;
+
+    for (const auto& symbol : m_replay_log.symbols()) {
+        quote_id id;
+        if (!add_quote(symbol, false, id))
+            std::cerr << "too many quotes, ignoring " << symbol << "\n";
+    }
+
+    m_replay_speed = speed;
+    m_replaying = true;
+    return true;
+}
+
+bool quote_engine::watch_config(const std::string& path)
+{
+    m_config_path = path;
+    return m_config_watcher.open(path);
+}
+
+void quote_engine::reload_config()
+{
+    config conf;
+    if (!load_config(m_config_path, conf)) {
+        std::cerr << "keeping the current config\n";
+        return;
+    }
+
+    configure(conf);
+}
+
+const quote_table& quote_engine::quotes() const
+{
+    return m_quotes;
+}
+
+const quote_history& quote_engine::history() const
+{
+    return m_history;
+}
+
+fetch_stats *quote_engine::stats() const
+{
+    return m_stats.get();
+}
+
+void quote_engine::dump_stats()
+{
+    if (!m_stats) {
+        std::cerr << "stats are disabled\n";
+        return;
+    }
+
+    if (m_stats_path.empty()) {
+        m_stats->dump(std::cerr, m_quotes.symbol);
+        return;
+    }
+
+    std::ofstream out { m_stats_path, std::ios::app };
+    if (!out) {
+        std::cerr << "failed to open " << m_stats_path << "\n";
+        return;
+    }
+    m_stats->dump(out, m_quotes.symbol);
+}
+
+void quote_engine::start()
+{
+    const time_t now { time(nullptr) };
+
+    m_started = true;
+
+    if (m_replaying) {
+        m_quote_fetcher->replay(m_replay_log, m_replay_speed);
+        return;
+    }
+
+    if (m_bus.is_open() && !m_bus.try_lead()) {
+        start_bus_reader(m_quotes.size());
+        m_next_bus_check = now + BUS_CHECK_INTERVAL;
+        return;
+    }
+
+    // poll until the stream is up
+    if (m_feed)
+        m_feed->start();
+
+    for (quote_id id = 0; id < m_quotes.size(); ++id)
+        schedule(id, now);
+}
+
+void quote_engine::schedule(quote_id id, time_t due)
+{
+    // a follower doesn't fetch, it's told; and nobody polls while the stream is up or
+    // a log is being replayed
+    if ((m_bus.is_open() && !m_bus.leader()) || m_streaming || m_replaying)
+        return;
+
+    if (!m_quotes.removed[id] || (m_bus_slots[id] != -1 && m_bus.leader()))
+        m_scheduler.schedule(id, due);
+}
+
+void quote_engine::schedule_updates()
+{
+    const time_t now { timer_clock_now() };
+
+    if (m_bus.is_open())
+        update_bus(now);
+
+    quote_id id;
+    while (m_scheduler.pop_due(now, id)) {
+        if (m_stats && m_quotes.retries[id] > 0)
+            m_stats->record_retry();
+        ++m_quotes.retries[id];
+
+        // no point in an answer that comes after the next fetch would have been due
+        const time_t interval { m_quotes.interval[id] ? m_quotes.interval[id] : m_policy.update_interval() };
+        time_t budget { interval > MIN_FETCH_BUDGET ? interval : MIN_FETCH_BUDGET };
+        if (budget > m_timeout)
+            budget = m_timeout;
+
+        m_quotes.pending[id] = 1;
+        m_quotes.overdue[id] = now + budget + WATCHDOG_GRACE;
+        m_quote_fetcher->fetch(id, std::chrono::seconds { budget });
+    }
+
+    time_t next_wakeup { m_scheduler.next_due() };
+
+    const time_t next_overdue { check_overdue(now) };
+    if (next_overdue && (next_wakeup == 0 || next_overdue < next_wakeup))
+        next_wakeup = next_overdue;
+
+    if (m_stats && m_stats_interval > 0) {
+        if (m_next_stats_dump == 0) {
+            m_next_stats_dump = now + m_stats_interval;
+        } else if (m_next_stats_dump <= now) {
+            dump_stats();
+            m_next_stats_dump = now + m_stats_interval;
+        }
+
+        if (next_wakeup == 0 || m_next_stats_dump < next_wakeup)
+            next_wakeup = m_next_stats_dump;
+    }
+
+    if (m_bus.is_open() && (next_wakeup == 0 || m_next_bus_check < next_wakeup))
+        next_wakeup = m_next_bus_check;
+
+    // every second while something flashes, so the front end can change its colors
+    if (m_alerts_until > now && (next_wakeup == 0 || now + 1 < next_wakeup))
+        next_wakeup = now + 1;
+
+    itimerspec timer {};
+    timer.it_value.tv_sec = next_wakeup;
+    timerfd_settime(m_timer_fd, TFD_TIMER_ABSTIME, &timer, nullptr);
+}
+
+time_t quote_engine::check_overdue(time_t now)
+{
+    // the fetcher enforces each fetch's budget itself; this only catches it failing to
+    // answer at all, so that a quote can't be left waiting forever
+
+    time_t next { 0 };
+
+    for (quote_id id = 0; id < m_quotes.size(); ++id) {
+        const time_t overdue { m_quotes.overdue[id] };
+
+        if (!m_quotes.pending[id] || overdue == 0)
+            continue;
+
+        if (overdue > now) {
+            if (next == 0 || overdue < next)
+                next = overdue;
+            continue;
+        }
+
+        std::cerr << "no answer for " << m_quotes.symbol[id] << ", giving up on it\n";
+
+        m_quotes.overdue[id] = 0;
+        m_quote_fetcher->cancel(id);
+        if (m_stats)
+            m_stats->record_overdue();
+
+        set_quote_error(id);
+    }
+
+    return next;
+}
+
+void quote_engine::reschedule_completed(std::vector<quote_id>& updated)
+{
+    for (auto id : m_completed) {
+        const auto quote = m_quotes.snapshot[id].load();
+
+        m_quotes.pending[id] = 0;
+        m_quotes.overdue[id] = 0;
+
+        time_t next_update;
+
+        if (quote.status == quote_status::FETCHED && quote.not_modified) {
+            // a 304 only moves the schedule along; there's nothing new to record or show
+
+            m_quotes.retries[id] = 0;
+            next_update = m_policy.next_update(id, m_quotes.size(), quote.last_update, false, m_quotes.interval[id]);
+        } else if (quote.status == quote_status::FETCHED) {
+            const auto samples = m_history.size(id);
+            const bool moved { samples > 0 && m_history.at(id, samples - 1).price != quote.last };
+
+            m_quotes.retries[id] = 0;
+            m_history.push(id, quote.last_update, quote.last);
+
+            next_update = m_policy.next_update(id, m_quotes.size(), quote.last_update, moved, m_quotes.interval[id]);
+        } else {
+            next_update = m_policy.next_retry(quote.last_update, m_quotes.retries[id]);
+        }
+
+        schedule(id, next_update);
+
+        if (!quote.not_modified)
+            updated.push_back(id);
+    }
+
+    m_completed.clear();
+
+    updated.insert(std::end(updated), std::begin(m_reconfigured), std::end(m_reconfigured));
+    m_reconfigured.clear();
+
+    fire_alerts(time(nullptr));
+
+    if (m_replay_done) {
+        if (m_stats)
+            dump_stats();
+        m_stopped = true;
+    }
+}
+
+bool quote_engine::wait_for_events(int fd)
+{
+    // a finished replay stops from within the loop; don't block on its way out
+    if (m_stopped)
+        return false;
+
+    pollfd fds[] {
+        { m_completed_fds[0], POLLIN, 0 },
+        { m_timer_fd, POLLIN, 0 },
+        { m_signal_fd, POLLIN, 0 },
+        { m_config_watcher.fd(), POLLIN, 0 },
+        { m_feed ? m_feed->fd() : -1, POLLIN, 0 },
+        { fd, POLLIN, 0 },
+    };
+
+    // poll skips negative fds, so the watcher, feed and fd are all optional
+
+    if (poll(fds, 6, -1) == -1)
+        return false;
+
+    if (fds[0].revents & POLLIN) {
+        const size_t drained { m_completed.size() };
+
+        quote_id ids[256];
+        ssize_t bytes;
+        while ((bytes = read(m_completed_fds[0], ids, sizeof(ids))) > 0) {
+            for (const quote_id *id = ids; id != ids + bytes/sizeof(*ids); ++id) {
+                if (*id == REPLAY_DONE)
+                    m_replay_done = true;
+                else
+                    m_completed.push_back(*id);
+            }
+        }
+
+        // only once the pipe is empty, so that no id is written and read twice in one drain,
+        // and before the snapshots are loaded, so that a later update is written again
+        for (auto id = std::begin(m_completed) + drained; id != std::end(m_completed); ++id)
+            m_notified[*id].store(false);
+    }
+
+    if (fds[1].revents & POLLIN) {
+        uint64_t expirations;
+        read(m_timer_fd, &expirations, sizeof(expirations));
+    }
+
+    if (fds[2].revents & POLLIN) {
+        signalfd_siginfo info;
+        while (read(m_signal_fd, &info, sizeof(info)) == sizeof(info)) {
+            if (info.ssi_signo == SIGUSR1)
+                dump_stats();
+            else
+                m_stopped = true;
+        }
+    }
+
+    if ((fds[3].revents & POLLIN) && m_config_watcher.changed())
+        reload_config();
+
+    if (fds[4].revents & POLLIN) {
+        m_feed->changed();
+        update_streaming();
+    }
+
+    return fd != -1 && (fds[5].revents & POLLIN);
+}
+
+bool quote_engine::stopped() const
+{
+    return m_stopped;
+}
+
+void quote_engine::update_bus(time_t now)
+{
+    if (now < m_next_bus_check)
+        return;
+
+    m_next_bus_check = now + BUS_CHECK_INTERVAL;
+
+    if (!m_bus.leader()) {
+        if (!m_bus.try_lead())
+            return;
+
+        // the leader went away; start fetching where it left off
+
+        stop_bus_reader();
+
+        if (m_feed)
+            m_feed->start();
+
+        for (quote_id id = 0; id < m_quotes.size(); ++id)
+            schedule(id, now);
+    }
+
+    // fetch whatever the other instances subscribed to as well
+
+    for (const uint32_t size { m_bus.size() }; m_bus_adopted < size; ++m_bus_adopted) {
+        std::string symbol;
+        quote_id id;
+        if (m_bus.symbol(m_bus_adopted, symbol) && !m_quotes.find(symbol, id) && add_quote(symbol, true, id))
+            schedule(id, now);
+    }
+}
+
+void quote_engine::publish(quote_id id, const quote_snapshot& quote)
+{
+    const int slot { m_bus_slots[id] };
+
+    if (slot == -1 || !m_bus.leader())
+        return;
+
+    quote_bus::quote previous;
+    if (!m_bus.read(slot, previous))
+        previous.serial = 0;
+
+    quote_bus::quote q;
+    q.last = quote.last.units();
+    q.change = quote.change.units();
+    q.percent_change = quote.percent_change.units();
+    q.last_update = quote.last_update;
+    q.serial = previous.serial + 1;
+    q.status = quote.status;
+
+    m_bus.publish(slot, q);
+}
+
+void quote_engine::start_bus_reader(size_t count)
+{
+    m_reading_bus = true;
+    m_bus_reader = std::thread { [this, count] { read_bus(count); } };
+}
+
+void quote_engine::stop_bus_reader()
+{
+    if (!m_bus_reader.joinable())
+        return;
+
+    m_reading_bus = false;
+    m_bus.wake();
+    m_bus_reader.join();
+}
+
+void quote_engine::read_bus(size_t count)
+{
+    // count is passed in rather than read here because the table may grow underneath us
+
+    std::vector<uint32_t> serials(count, 0);
+
+    while (m_reading_bus) {
+        const uint32_t generation { m_bus.generation() };
+
+        for (quote_id id = 0; id < serials.size(); ++id) {
+            quote_bus::quote q;
+
+            if (m_bus_slots[id] == -1 || !m_bus.read(m_bus_slots[id], q) || q.serial == serials[id])
+                continue;
+
+            serials[id] = q.serial;
+
+            const auto current = m_quotes.snapshot[id].load();
+            const decimal last { decimal::from_units(q.last) };
+            const decimal change { decimal::from_units(q.change) };
+            const decimal percent_change { decimal::from_units(q.percent_change) };
+
+            if (q.status != quote_status::FETCHED)
+                set_quote_error(id);
+            else if (current.status == quote_status::FETCHED && !current.stale &&
+                     current.last == last && current.change == change && current.percent_change == percent_change)
+                set_quote_unchanged(id);
+            else
+                set_quote_state(id, last, change, percent_change);
+        }
+
+        m_bus.wait(generation, 1000);
+    }
+}
+
+void quote_engine::update_streaming()
+{
+    const bool live { m_feed->live() };
+
+    if (live == m_streaming)
+        return;
+
+    // stop polling once the stream is up, and pick it back up where the stream left off
+    // when it drops
+
+    const time_t now { time(nullptr) };
+
+    if (live) {
+        for (quote_id id = 0; id < m_quotes.size(); ++id)
+            m_scheduler.cancel(id);
+    }
+
+    m_streaming = live;
+
+    if (!live) {
+        for (quote_id id = 0; id < m_quotes.size(); ++id) {
+            if (!m_quotes.pending[id])
+                schedule(id, now);
+        }
+    }
+}
+
+void quote_engine::fire_alerts(time_t now)
+{
+    // only our own children: whatever embeds the engine may be waiting for others
+    m_alert_commands.erase(std::remove_if(std::begin(m_alert_commands), std::end(m_alert_commands),
+                                          [](pid_t pid) { return waitpid(pid, nullptr, WNOHANG) != 0; }),
+                           std::end(m_alert_commands));
+
+    {
+        std::unique_lock<std::mutex> lock { m_sink_mutex };
+        m_firing.swap(m_fired);
+    }
+
+    for (const auto& alert : m_firing) {
+        const auto& rule = m_alerts.rule(alert.rule);
+
+        char level[decimal::TEXT_SIZE], value[decimal::TEXT_SIZE];
+        format_decimal(level, rule.level);
+        format_decimal(value, alert.value);
+
+        std::cerr << "alert: " << rule.symbol << " " << alert_kind_name(rule.kind) << " " << level << " at " << value << "\n";
+
+        m_quotes.alerted[alert.id] = now + ALERT_FLASH;
+        m_alerts_until = now + ALERT_FLASH;
+
+        if (m_stats)
+            m_stats->record_alert();
+
+        if (!rule.command.empty())
+            run_alert_command(rule, alert);
+    }
+
+    m_firing.clear();
+}
+
+void quote_engine::run_alert_command(const alert_config& rule, const quote_alerts::fired& alert)
+{
+    // what fired goes in the environment; the command's output goes to stderr so that it
+    // can't end up in the headless stream
+
+    char level[decimal::TEXT_SIZE], value[decimal::TEXT_SIZE];
+    format_decimal(level, rule.level);
+    format_decimal(value, alert.value);
+
+    std::vector<std::string> variables {
+        "WMIBOV_SYMBOL=" + rule.symbol,
+        std::string { "WMIBOV_ALERT=" } + alert_kind_name(rule.kind),
+        std::string { "WMIBOV_LEVEL=" } + level,
+        std::string { "WMIBOV_VALUE=" } + value,
+    };
+
+    std::vector<char *> env;
+    for (char **e = environ; *e; ++e)
+        env.push_back(*e);
+    for (auto& v : variables)
+        env.push_back(&v[0]);
+    env.push_back(nullptr);
+
+    char *argv[] { "sh", "-c", const_cast<char *>(rule.command.c_str()), nullptr };
+
+    // the signals the main loop reads are blocked here, and children inherit that
+
+    posix_spawnattr_t attr;
+    posix_spawnattr_init(&attr);
+    sigset_t none;
+    sigemptyset(&none);
+    posix_spawnattr_setsigmask(&attr, &none);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGMASK);
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, STDERR_FILENO, STDOUT_FILENO);
+
+    pid_t pid;
+    const int result { posix_spawn(&pid, "/bin/sh", &actions, &attr, argv, env.data()) };
+
+    posix_spawn_file_actions_destroy(&actions);
+    posix_spawnattr_destroy(&attr);
+
+    if (result == 0)
+        m_alert_commands.push_back(pid);
+    else
+        std::cerr << "failed to run alert command for " << rule.symbol << ": " << strerror(result) << "\n";
+}
+
+void quote_engine::notify_completed(quote_id id)
+{
+    // already waiting to be read, and the reader loads the latest snapshot anyway
+    if (id != REPLAY_DONE && m_notified[id].exchange(true))
+        return;
+
+    write(m_completed_fds[1], &id, sizeof(id));
+}
+
+void quote_engine::set_quote_state(quote_id id, decimal last, decimal change, decimal percent_change)
+{
+    std::unique_lock<std::mutex> lock { m_sink_mutex };
+
+    quote_snapshot quote;
+    quote.last = last;
+    quote.change = change;
+    quote.percent_change = percent_change;
+    format_quote(last, change, percent_change, quote.text);
+    quote.last_update = m_replaying ? m_replay_time : time(nullptr);
+    quote.status = quote_status::FETCHED;
+    quote.received = steady_clock_micros();
+    m_quotes.snapshot[id].store(quote);
+
+    m_cache.store(m_cache_slots[id], quote.last_update, last, change, percent_change);
+
+    m_alerts.update(id, quote.last_update, last, percent_change, m_fired);
+
+    publish(id, quote);
+    notify_completed(id);
+}
+
+void quote_engine::set_quote_unchanged(quote_id id)
+{
+    // after an error the values are the same, but the status going back to normal is news
+
+    std::unique_lock<std::mutex> lock { m_sink_mutex };
+
+    auto quote = m_quotes.snapshot[id].load();
+
+    // a new price still waiting in the pipe hasn't been recorded yet; a 304 after it mustn't
+    // hide it
+    const bool unread_update { m_notified[id].load() && !quote.not_modified };
+
+    quote.last_update = m_replaying ? m_replay_time : time(nullptr);
+    quote.not_modified = quote.status == quote_status::FETCHED && !unread_update;
+    quote.status = quote_status::FETCHED;
+    m_quotes.snapshot[id].store(quote);
+
+    publish(id, quote);
+    notify_completed(id);
+}
+
+void quote_engine::set_replay_time(time_t time)
+{
+    std::unique_lock<std::mutex> lock { m_sink_mutex };
+    m_replay_time = time;
+}
+
+void quote_engine::set_replay_done()
+{
+    notify_completed(REPLAY_DONE);
+}
+
+void quote_engine::set_quote_error(quote_id id)
+{
+    // keep the last good values around, only the status changes
+
+    std::unique_lock<std::mutex> lock { m_sink_mutex };
+
+    auto quote = m_quotes.snapshot[id].load();
+    quote.last_update = m_replaying ? m_replay_time : time(nullptr);
+    quote.status = quote_status::ERROR;
+    quote.not_modified = false;
+    m_quotes.snapshot[id].store(quote);
+
+    publish(id, quote);
+    notify_completed(id);
+}
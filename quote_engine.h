@@ -0,0 +1,182 @@
+#pragma once
+
+#include <sys/types.h>
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <boost/core/noncopyable.hpp>
+
+#include "config.h"
+#include "config_watcher.h"
+#include "quote_sink.h"
+#include "quote_provider.h"
+#include "quote_feed.h"
+#include "quote_log.h"
+#include "quote_bus.h"
+#include "quote_table.h"
+#include "quote_scheduler.h"
+#include "refresh_policy.h"
+#include "quote_cache.h"
+#include "quote_alerts.h"
+#include "quote_history.h"
+#include "fetch_stats.h"
+
+class quote_fetcher;
+
+// Everything about keeping quotes up to date that doesn't need a display: the quote table,
+// scheduling, fetching, history, cache and stats. A front end drives it from its own loop:
+//
+//     engine.start();
+//     while (!engine.stopped()) {
+//         engine.reschedule_completed(updated);
+//         engine.schedule_updates();
+//         ... show what's in updated ...
+//         engine.wait_for_events(fd);
+//     }
+
+class quote_engine : public quote_sink, private boost::noncopyable
+{
+public:
+    quote_engine();
+    ~quote_engine();
+
+    bool initialize();
+    bool load_cache(const std::string& path);
+    void add_provider(std::unique_ptr<quote_provider> provider);
+    void set_history_size(size_t history_size);
+    void enable_stats(const std::string& path, time_t interval);
+
+    // share one upstream poller between the instances on this host; before configure
+    bool enable_bus(const std::string& name);
+
+    // take ticks from a server-sent events stream while it's up and only poll while it's
+    // down; before configure
+    bool enable_stream(const stream_config& stream, long connect_timeout, long stall_timeout);
+
+    // applies the watchlist and refresh settings as a diff against the current ones: new
+    // symbols are added, dropped ones hidden and no longer fetched, everything else kept;
+    // alert rules are replaced
+    void configure(const config& conf);
+
+    // save every response for replay
+    bool record(const std::string& path);
+
+    // show what a recorded log holds instead of fetching, then stop; before configure, which
+    // then leaves the symbols alone
+    bool enable_replay(const std::string& path, double speed);
+
+    // reapply the config whenever the file changes
+    bool watch_config(const std::string& path);
+
+    const quote_table& quotes() const;
+    const quote_history& history() const;
+    fetch_stats *stats() const;
+
+    void start();
+    void schedule_updates();
+
+    // appends the quotes whose values, status or visibility changed since the last call, and
+    // acts on the alerts that fired: their quotes flash until alerted says so
+    void reschedule_completed(std::vector<quote_id>& updated);
+
+    // blocks until a fetch completes, a timer or signal fires, the config changes, or fd
+    // (if not -1) is readable; returns whether fd is
+    bool wait_for_events(int fd);
+
+    // SIGINT or SIGTERM was received
+    bool stopped() const;
+
+    void set_quote_state(quote_id id, decimal last, decimal change, decimal percent_change) override;
+    void set_quote_unchanged(quote_id id) override;
+    void set_quote_error(quote_id id) override;
+    void set_replay_time(time_t time) override;
+    void set_replay_done() override;
+
+private:
+    bool add_quote(const std::string& symbol, bool hidden, quote_id& id);
+    void schedule(quote_id id, time_t due);
+    void reload_config();
+    void set_alerts(const config& conf);
+    void fire_alerts(time_t now);
+    void run_alert_command(const alert_config& rule, const quote_alerts::fired& alert);
+    void notify_completed(quote_id id);
+    void update_streaming();
+    time_t check_overdue(time_t now);
+    void dump_stats();
+
+    void update_bus(time_t now);
+    void publish(quote_id id, const quote_snapshot& quote);
+    void start_bus_reader(size_t count);
+    void stop_bus_reader();
+    void read_bus(size_t count);
+
+    static const quote_id REPLAY_DONE = UINT32_MAX; // sent down the completion pipe
+
+    static const time_t BUS_CHECK_INTERVAL = 5;
+    static const time_t MIN_FETCH_BUDGET = 5;
+    static const time_t WATCHDOG_GRACE = 5;
+    static const time_t ALERT_FLASH = 10;
+
+    quote_table m_quotes;
+    quote_history m_history;
+
+    std::unique_ptr<fetch_stats> m_stats;
+    std::string m_stats_path;
+    time_t m_stats_interval = 0;
+    time_t m_next_stats_dump = 0;
+
+    quote_cache m_cache;
+    std::vector<int> m_cache_slots;
+    std::vector<quote_id> m_completed;
+
+    // set while a quote's id is in the completion pipe, so that it's there at most once
+    std::unique_ptr<std::atomic<bool>[]> m_notified { new std::atomic<bool>[quote_table::MAX_QUOTES] {} };
+
+    quote_scheduler m_scheduler;
+    refresh_policy m_policy;
+    time_t m_timeout = 30;
+
+    std::unique_ptr<quote_fetcher> m_quote_fetcher;
+
+    std::unique_ptr<quote_feed> m_feed;
+    bool m_streaming = false; // the feed was live when last checked, so nothing is polled
+
+    // the fetcher, feed and bus reader threads all deliver quotes
+    std::mutex m_sink_mutex;
+
+    // checked as quotes are delivered, acted on from the main loop
+    quote_alerts m_alerts;
+    std::vector<quote_alerts::fired> m_fired;
+    std::vector<quote_alerts::fired> m_firing;
+    time_t m_alerts_until = 0;
+    std::vector<pid_t> m_alert_commands; // still to be reaped
+
+    // while another instance leads, quotes come from the bus instead of the fetcher
+    quote_bus m_bus;
+    std::vector<int> m_bus_slots;
+    uint32_t m_bus_adopted = 0;
+    time_t m_next_bus_check = 0;
+    std::atomic<bool> m_reading_bus { false };
+    std::thread m_bus_reader;
+
+    quote_log_reader m_replay_log;
+    double m_replay_speed = 1;
+    bool m_replaying = false;
+    bool m_replay_done = false;
+    time_t m_replay_time = 0; // of the record being delivered
+
+    std::string m_config_path;
+    config_watcher m_config_watcher;
+    std::vector<quote_id> m_reconfigured;
+    bool m_started = false;
+
+    int m_completed_fds[2] { -1, -1 };
+    int m_timer_fd = -1;
+    int m_signal_fd = -1;
+    bool m_stopped = false;
+};
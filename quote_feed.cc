@@ -0,0 +1,396 @@
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+#include "quote_feed.h"
+
+quote_feed::quote_feed(quote_sink& sink, const std::string& url, const std::string& symbol_key, const quote_fields& fields)
+    : m_sink { sink }
+    , m_url { url }
+    , m_symbol_key { symbol_key }
+    , m_fields { fields }
+{
+}
+
+quote_feed::~quote_feed()
+{
+    {
+        std::unique_lock<std::mutex> lock { m_mutex };
+        m_done = true;
+    }
+    m_condition.notify_one();
+
+    if (m_multi)
+        curl_multi_wakeup(m_multi);
+
+    if (m_thread.joinable())
+        m_thread.join();
+
+    if (m_curl)
+        curl_easy_cleanup(m_curl);
+
+    if (m_multi)
+        curl_multi_cleanup(m_multi);
+
+    if (m_event_fd != -1)
+        close(m_event_fd);
+}
+
+bool quote_feed::initialize()
+{
+    m_event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (m_event_fd == -1) {
+        std::cerr << "failed to create quote feed event fd\n";
+        return false;
+    }
+
+    // driven through a multi handle only so that shutdown and resubscribing can interrupt it
+
+    m_multi = curl_multi_init();
+    m_curl = curl_easy_init();
+    if (!m_multi || !m_curl) {
+        std::cerr << "failed to create quote feed handle\n";
+        return false;
+    }
+
+    curl_easy_setopt(m_curl, CURLOPT_NOSIGNAL, 1l);
+    curl_easy_setopt(m_curl, CURLOPT_WRITEFUNCTION, static_write_callback);
+    curl_easy_setopt(m_curl, CURLOPT_WRITEDATA, this);
+    curl_easy_setopt(m_curl, CURLOPT_TCP_KEEPALIVE, 1l);
+
+    return true;
+}
+
+void quote_feed::set_timeouts(long connect_timeout, long stall_timeout)
+{
+    m_connect_timeout = connect_timeout;
+    m_stall_timeout = stall_timeout;
+}
+
+void quote_feed::set_stats(fetch_stats *stats)
+{
+    m_stats = stats;
+}
+
+void quote_feed::add_quote(quote_id id, const std::string& symbol)
+{
+    {
+        std::unique_lock<std::mutex> lock { m_mutex };
+        if (m_subscriptions.count(symbol))
+            return;
+        m_subscriptions[symbol].id = id;
+        m_resubscribe = m_started;
+    }
+    m_condition.notify_one();
+    curl_multi_wakeup(m_multi);
+}
+
+void quote_feed::start()
+{
+    std::unique_lock<std::mutex> lock { m_mutex };
+
+    if (m_started)
+        return;
+
+    m_started = true;
+    m_thread = std::thread { [this] { run(); } };
+}
+
+bool quote_feed::live() const
+{
+    return m_live;
+}
+
+int quote_feed::fd() const
+{
+    return m_event_fd;
+}
+
+void quote_feed::changed()
+{
+    uint64_t count;
+    read(m_event_fd, &count, sizeof(count));
+}
+
+void quote_feed::set_live(bool live)
+{
+    if (m_live.exchange(live) == live)
+        return;
+
+    if (!live && m_stats)
+        m_stats->record_stream_drop();
+
+    const uint64_t one { 1 };
+    write(m_event_fd, &one, sizeof(one));
+}
+
+void quote_feed::run()
+{
+    long delay { MIN_RETRY };
+
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock { m_mutex };
+            if (m_done)
+                break;
+            m_resubscribe = false;
+        }
+
+        const bool delivered { connect() };
+
+        {
+            std::unique_lock<std::mutex> lock { m_mutex };
+            if (m_done)
+                break;
+
+            // a new symbol; the pollers stay off for the moment it takes to reconnect
+            if (m_resubscribe)
+                continue;
+        }
+
+        set_live(false);
+
+        // the server's retry if the stream was up, backing off if it won't come up at all
+        delay = delivered ? m_retry : delay*2 < MAX_RETRY ? delay*2 : MAX_RETRY;
+        wait_to_retry(delay);
+    }
+
+    set_live(false);
+}
+
+bool quote_feed::connect()
+{
+    m_line.clear();
+    m_data.clear();
+    m_skip_lf = false;
+    m_checked_response = false;
+
+    curl_slist *headers { curl_slist_append(nullptr, "Accept: text/event-stream") };
+    if (!m_last_event_id.empty())
+        headers = curl_slist_append(headers, ("Last-Event-ID: " + m_last_event_id).c_str());
+
+    const std::string address { url() };
+
+    curl_easy_setopt(m_curl, CURLOPT_URL, address.c_str());
+    curl_easy_setopt(m_curl, CURLOPT_HTTPHEADER, headers);
+    curl_easy_setopt(m_curl, CURLOPT_CONNECTTIMEOUT, m_connect_timeout);
+
+    // the stream never ends by itself; it's dead once nothing, not even a keepalive
+    // comment, has come for a while
+    curl_easy_setopt(m_curl, CURLOPT_LOW_SPEED_LIMIT, 1l);
+    curl_easy_setopt(m_curl, CURLOPT_LOW_SPEED_TIME, m_stall_timeout);
+
+    curl_multi_add_handle(m_multi, m_curl);
+
+    CURLcode result { CURLE_OK };
+    bool finished { false };
+
+    while (!finished) {
+        int running;
+        curl_multi_perform(m_multi, &running);
+
+        if (!check_response())
+            break;
+
+        int queued;
+        while (CURLMsg *message = curl_multi_info_read(m_multi, &queued)) {
+            if (message->msg == CURLMSG_DONE) {
+                result = message->data.result;
+                finished = true;
+            }
+        }
+
+        {
+            std::unique_lock<std::mutex> lock { m_mutex };
+            if (m_done || m_resubscribe)
+                break;
+        }
+
+        if (!finished)
+            curl_multi_poll(m_multi, nullptr, 0, 1000, nullptr);
+    }
+
+    curl_multi_remove_handle(m_multi, m_curl);
+    curl_easy_setopt(m_curl, CURLOPT_HTTPHEADER, nullptr);
+    curl_slist_free_all(headers);
+
+    if (finished && result == CURLE_OK)
+        std::cerr << "quote stream " << address << " ended\n";
+    else if (finished)
+        std::cerr << "quote stream " << address << ": " << curl_easy_strerror(result) << "\n";
+
+    return m_live;
+}
+
+bool quote_feed::check_response()
+{
+    if (m_checked_response)
+        return true;
+
+    long response_code { 0 };
+    curl_easy_getinfo(m_curl, CURLINFO_RESPONSE_CODE, &response_code);
+
+    if (response_code == 200) {
+        m_checked_response = true;
+        set_live(true);
+    } else if (response_code != 0) {
+        std::cerr << "quote stream answered " << response_code << "\n";
+        return false;
+    }
+
+    return true;
+}
+
+std::string quote_feed::url() const
+{
+    std::string symbols;
+
+    {
+        std::unique_lock<std::mutex> lock { m_mutex };
+        for (const auto& s : m_subscriptions) {
+            char *escaped { curl_easy_escape(m_curl, s.first.data(), s.first.size()) };
+            if (!escaped)
+                continue;
+            if (!symbols.empty())
+                symbols += ',';
+            symbols += escaped;
+            curl_free(escaped);
+        }
+    }
+
+    static const std::string placeholder { "{symbols}" };
+
+    std::string url { m_url };
+
+    const auto pos = url.find(placeholder);
+    if (pos != std::string::npos)
+        url.replace(pos, placeholder.size(), symbols);
+    else
+        url += (url.find('?') == std::string::npos ? "?symbols=" : "&symbols=") + symbols;
+
+    return url;
+}
+
+void quote_feed::wait_to_retry(long millis)
+{
+    std::unique_lock<std::mutex> lock { m_mutex };
+    m_condition.wait_for(lock, std::chrono::milliseconds { millis }, [this] { return m_done || m_resubscribe; });
+}
+
+size_t quote_feed::static_write_callback(char *buffer, size_t size, size_t nmemb, void *userp)
+{
+    return static_cast<quote_feed *>(userp)->on_data(buffer, size*nmemb);
+}
+
+size_t quote_feed::on_data(const char *data, size_t size)
+{
+    // lines end in \n, \r\n or a lone \r, and may be split across chunks
+
+    for (const char *p = data; p != data + size; ++p) {
+        if (m_skip_lf) {
+            m_skip_lf = false;
+            if (*p == '\n')
+                continue;
+        }
+
+        if (*p == '\n' || *p == '\r') {
+            m_skip_lf = *p == '\r';
+            if (!on_line(m_line.data(), m_line.data() + m_line.size()))
+                return 0;
+            m_line.clear();
+        } else if (m_line.size() == MAX_LINE) {
+            // a short count makes curl fail the transfer, and the stream reconnects
+            std::cerr << "quote stream line too long, dropping the connection\n";
+            return 0;
+        } else {
+            m_line.push_back(*p);
+        }
+    }
+
+    return size;
+}
+
+bool quote_feed::on_line(const char *begin, const char *end)
+{
+    // false if the event is too big to keep
+
+    if (begin == end) {
+        on_event();
+        return true;
+    }
+
+    // comments are keepalives
+    if (*begin == ':')
+        return true;
+
+    const char *colon { static_cast<const char *>(memchr(begin, ':', end - begin)) };
+    const char *value { colon ? colon + 1 : end };
+    if (value != end && *value == ' ')
+        ++value;
+
+    const size_t name_length = (colon ? colon : end) - begin;
+
+    if (name_length == 4 && memcmp(begin, "data", 4) == 0) {
+        if (m_data.size() + (end - value) >= MAX_LINE) {
+            std::cerr << "quote stream event too long, dropping the connection\n";
+            return false;
+        }
+        if (!m_data.empty())
+            m_data += '\n';
+        m_data.append(value, end);
+    } else if (name_length == 2 && memcmp(begin, "id", 2) == 0) {
+        m_last_event_id.assign(value, end);
+    } else if (name_length == 5 && memcmp(begin, "retry", 5) == 0) {
+        const long retry { atol(std::string { value, end }.c_str()) };
+        if (retry > 0)
+            m_retry = retry < MAX_RETRY ? retry : MAX_RETRY;
+    }
+
+    return true;
+}
+
+void quote_feed::on_event()
+{
+    if (m_data.empty())
+        return;
+
+    quote_values values;
+
+    const bool valid { parse_string_field(m_data.data(), m_data.size(), m_symbol_key, m_symbol) &&
+                       parse_quote(m_data.data(), m_data.size(), values, m_fields) == parse_result::OK };
+
+    m_data.clear();
+
+    if (!valid)
+        return;
+
+    quote_id id;
+    bool unchanged;
+
+    {
+        std::unique_lock<std::mutex> lock { m_mutex };
+
+        const auto it = m_subscriptions.find(m_symbol);
+        if (it == std::end(m_subscriptions))
+            return;
+
+        auto& s = it->second;
+        id = s.id;
+        unchanged = s.seen && s.values.last == values.last && s.values.change == values.change &&
+                    s.values.percent_change == values.percent_change;
+        s.values = values;
+        s.seen = true;
+    }
+
+    if (m_stats)
+        m_stats->record_tick();
+
+    if (unchanged)
+        m_sink.set_quote_unchanged(id);
+    else
+        m_sink.set_quote_state(id, values.last, values.change, values.percent_change);
+}
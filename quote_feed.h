@@ -0,0 +1,102 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+#include <curl/curl.h>
+
+#include <boost/core/noncopyable.hpp>
+
+#include "quote_parser.h"
+#include "quote_table.h"
+#include "quote_sink.h"
+#include "fetch_stats.h"
+
+// Server-sent events subscription: one long-lived GET for every symbol, which the server
+// answers with an event per tick whose data is a JSON object holding the symbol and the
+// values. Runs on its own thread and hands ticks to the sink as they arrive, the same way
+// the fetcher hands over responses.
+//
+// The symbols replace {symbols} in the URL, comma separated, or are appended as a symbols
+// query parameter. A dropped stream is reconnected with backoff, sending Last-Event-ID so
+// the server can replay what was missed; fd() becomes readable whenever live() changes so
+// the owner can poll in the meantime.
+
+class quote_feed : private boost::noncopyable
+{
+public:
+    quote_feed(quote_sink& sink, const std::string& url, const std::string& symbol_key, const quote_fields& fields);
+    ~quote_feed();
+
+    bool initialize();
+    void set_timeouts(long connect_timeout, long stall_timeout);
+    void set_stats(fetch_stats *stats);
+
+    // reconnects with the new symbol if already started
+    void add_quote(quote_id id, const std::string& symbol);
+
+    void start();
+    bool live() const;
+
+    // readable when live() changed; call changed() to drain it
+    int fd() const;
+    void changed();
+
+private:
+    struct subscription
+    {
+        quote_id id;
+        quote_values values;
+        bool seen = false;
+    };
+
+    void run();
+    bool connect();
+    bool check_response();
+    std::string url() const;
+    void set_live(bool live);
+    void wait_to_retry(long millis);
+
+    size_t on_data(const char *data, size_t size);
+    bool on_line(const char *begin, const char *end);
+    void on_event();
+
+    static size_t static_write_callback(char *buffer, size_t size, size_t nmemb, void *userp);
+
+    static const long MIN_RETRY = 1000;
+    static const long MAX_RETRY = 60000;
+    static const size_t MAX_LINE = 64*1024; // and event; a stream that sends more is dropped
+
+    quote_sink& m_sink;
+    std::string m_url;
+    std::string m_symbol_key;
+    quote_fields m_fields;
+    long m_connect_timeout = 10;
+    long m_stall_timeout = 30;
+    fetch_stats *m_stats = nullptr;
+
+    CURLM *m_multi = nullptr;
+    CURL *m_curl = nullptr;
+    std::string m_line;
+    std::string m_data;
+    std::string m_symbol;
+    std::string m_last_event_id;
+    long m_retry = MIN_RETRY;
+    bool m_skip_lf = false;
+    bool m_checked_response = false;
+
+    std::unordered_map<std::string, subscription> m_subscriptions;
+    bool m_resubscribe = false;
+    bool m_started = false;
+    bool m_done = false;
+    mutable std::mutex m_mutex;
+    std::condition_variable m_condition;
+
+    std::atomic<bool> m_live { false };
+    int m_event_fd = -1;
+    std::thread m_thread;
+};
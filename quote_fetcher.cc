@@ -1,72 +1,679 @@
-#include <boost/lexical_cast.hpp>
-#include <boost/property_tree/ptree.hpp>
-#include <boost/property_tree/json_parser.hpp>
-
-#include "curl_request.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <unordered_map>
 
 #include "quote_fetcher.h"
 
-quote_fetcher::quote_fetcher(wm_window& window)
-    : m_window { window }
-    , m_thread {
-        [this]()
+namespace {
+
+// a fetch with less than this left of its budget isn't worth sending anywhere
+const std::chrono::milliseconds MIN_ATTEMPT { 50 };
+
+}
+
+quote_fetcher::quote_fetcher(quote_sink& sink)
+    : m_sink { sink }
+    , m_multi { curl_multi_init() }
+    , m_share { curl_share_init() }
+{
+    // the share is only ever used from the fetcher thread, so it needs no lock callbacks
+
+    curl_share_setopt(m_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(m_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+    curl_share_setopt(m_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+
+    m_thread = std::thread { [this] { run(); } };
+}
+
+quote_fetcher::~quote_fetcher()
+{
+    {
+        std::unique_lock<std::mutex> lock { m_mutex };
+        m_done = true;
+    }
+    m_condition.notify_one();
+    m_replay_condition.notify_one();
+    curl_multi_wakeup(m_multi);
+    m_thread.join();
+
+    if (m_replay_thread.joinable())
+        m_replay_thread.join();
+
+    for (auto& t : m_transfers)
+        curl_multi_remove_handle(m_multi, t->request.handle());
+    m_transfers.clear();
+
+    curl_multi_cleanup(m_multi);
+    curl_share_cleanup(m_share);
+}
+
+void quote_fetcher::add_provider(std::unique_ptr<quote_provider> provider)
+{
+    std::unique_lock<std::mutex> lock { m_mutex };
+
+    if (m_providers.size() == 32) {
+        std::cerr << "too many quote providers, ignoring " << provider->name() << "\n";
+        return;
+    }
+
+    m_order.push_back(m_providers.size());
+    m_providers.emplace_back(new provider_state);
+    m_providers.back()->provider = std::move(provider);
+}
+
+void quote_fetcher::set_max_requests(int max_requests)
+{
+    std::unique_lock<std::mutex> lock { m_mutex };
+    m_max_requests = std::max(max_requests, 1);
+}
+
+void quote_fetcher::set_timeouts(long connect_timeout, long timeout)
+{
+    std::unique_lock<std::mutex> lock { m_mutex };
+    m_connect_timeout = connect_timeout;
+    m_timeout = timeout;
+}
+
+void quote_fetcher::set_stats(fetch_stats *stats)
+{
+    std::unique_lock<std::mutex> lock { m_mutex };
+    m_stats = stats;
+}
+
+void quote_fetcher::add_quote(quote_id id, const std::string& symbol)
+{
+    std::unique_lock<std::mutex> lock { m_mutex };
+    if (id >= m_symbols.size()) {
+        m_symbols.resize(id + 1);
+        m_urls.resize(id + 1);
+        m_validators.resize(id + 1);
+        m_deadlines.resize(id + 1);
+    }
+    m_symbols[id] = symbol;
+    m_urls[id].clear();
+}
+
+void quote_fetcher::fetch(quote_id id, std::chrono::milliseconds budget)
+{
+    {
+        std::unique_lock<std::mutex> lock { m_mutex };
+        m_deadlines[id] = std::chrono::steady_clock::now() + std::min<std::chrono::milliseconds>(budget, std::chrono::seconds { m_timeout });
+        m_queue.push_back(id);
+    }
+    m_condition.notify_one();
+    curl_multi_wakeup(m_multi);
+}
+
+void quote_fetcher::cancel(quote_id id)
+{
+    {
+        std::unique_lock<std::mutex> lock { m_mutex };
+        m_queue.erase(std::remove(std::begin(m_queue), std::end(m_queue), id), std::end(m_queue));
+        m_cancelled.push_back(id);
+    }
+    curl_multi_wakeup(m_multi);
+}
+
+bool quote_fetcher::record(const std::string& path)
+{
+    m_recording = m_recorder.open(path);
+    return m_recording;
+}
+
+void quote_fetcher::replay(quote_log_reader& log, double speed)
+{
+    m_replay_thread = std::thread { [this, &log, speed] { run_replay(log, speed); } };
+}
+
+void quote_fetcher::run_replay(quote_log_reader& log, double speed)
+{
+    std::unordered_map<std::string, quote_id> ids;
+
+    {
+        std::unique_lock<std::mutex> lock { m_mutex };
+        for (quote_id id = 0; id < m_symbols.size(); ++id)
+            ids[m_symbols[id]] = id;
+    }
+
+    const auto started = std::chrono::steady_clock::now();
+    int64_t first_time { 0 };
+    size_t count { 0 };
+
+    quote_log_reader::record r;
+
+    while (log.next(r)) {
+        if (count == 0)
+            first_time = r.time;
+
         {
-            curl_request request;
+            std::unique_lock<std::mutex> lock { m_mutex };
 
-            while (true) {
-                std::string symbol;
-                {
-                    std::unique_lock<std::mutex> lock { m_mutex };
+            if (speed > 0) {
+                const auto due = started + std::chrono::microseconds { static_cast<int64_t>((r.time - first_time)/speed) };
+                m_replay_condition.wait_until(lock, due, [&] { return m_done || std::chrono::steady_clock::now() >= due; });
+            }
 
-                    while (!m_done && m_queue.empty())
-                        m_condition.wait(lock);
+            if (m_done)
+                break;
+        }
 
-                    if (m_done)
-                        break;
+        ++count;
 
-                    symbol = m_queue.front();
-                    m_queue.pop_front();
-                }
+        const auto it = ids.find(r.symbol);
+        if (it == std::end(ids) || m_providers.empty())
+            continue;
+
+        m_sink.set_replay_time(static_cast<time_t>(r.time/1000000));
+
+        if (r.not_modified)
+            m_sink.set_quote_unchanged(it->second);
+        else if (!deliver(it->second, r.provider < m_providers.size() ? r.provider : 0, r.body, r.size))
+            m_sink.set_quote_error(it->second);
+    }
+
+    const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started).count();
+    std::cerr << "replayed " << count << " responses in " << elapsed << " ms\n";
+
+    m_sink.set_replay_done();
+}
+
+void quote_fetcher::run()
+{
+    while (start_transfers()) {
+        curl_multi_perform(m_multi, &m_running);
+
+        const int finished { finish_transfers() };
+        start_hedges();
+
+        // refill freed slots straight away; only wait on the sockets when nothing finished
+
+        if (finished == 0 && m_running > 0)
+            curl_multi_poll(m_multi, nullptr, 0, next_hedge_timeout(), nullptr);
+    }
+}
+
+bool quote_fetcher::start_transfers()
+{
+    // move queued symbols into free transfer slots; block while there's nothing at all to do
+
+    std::vector<quote_id> failed;
+
+    {
+        std::unique_lock<std::mutex> lock { m_mutex };
+
+        while (!m_done && m_queue.empty() && m_running == 0)
+            m_condition.wait(lock);
+
+        if (m_done)
+            return false;
 
-                request.set_url(std::string { "http://exame.abril.com.br/coletor/quote/" } + symbol);
+        // before anything new starts, so that a fetch requested after a cancel isn't caught by it
+        cancel_transfers();
 
-                if (request.fetch() && request.response_code() == 200) {
-                    std::stringstream response { request.buffer() };
+        // fetches whose budget ran out while waiting for a slot fail here: there's no point
+        // asking the provider now, and it's not the provider's fault
 
-                    boost::property_tree::ptree tree;
-                    boost::property_tree::read_json(response, tree);
+        const auto cutoff = std::chrono::steady_clock::now() + MIN_ATTEMPT;
+        const auto expired = std::stable_partition(std::begin(m_queue), std::end(m_queue),
+                                                   [&](quote_id id) { return m_deadlines[id] > cutoff; });
+        failed.insert(std::end(failed), expired, std::end(m_queue));
+        m_queue.erase(expired, std::end(m_queue));
 
-                    double last = boost::lexical_cast<double>(tree.get("trdprc_1", "0"));
-                    double change_percent = boost::lexical_cast<double>(tree.get("pctchng", "0"));
-                    double change = boost::lexical_cast<double>(tree.get("netchng_1", "0"));
+        auto queued = std::begin(m_queue);
 
-                    // XXX catch bad_lexical_cast
+        for (; queued != std::end(m_queue); ++queued) {
+            size_t provider;
+            if (!next_provider(0, provider)) {
+                failed.push_back(*queued);
+                continue;
+            }
+
+            transfer *t { get_transfer() };
+            if (!t)
+                break;
+
+            t->id = *queued;
+            t->deadline = m_deadlines[t->id];
+            t->tried = 0;
+            t->hedged = m_providers.size() < 2;
+            t->hedge = false;
+            launch(t, provider);
+        }
+
+        m_queue.erase(std::begin(m_queue), queued);
+    }
+
+    for (auto id : failed)
+        m_sink.set_quote_error(id);
+
+    add_started();
+
+    return true;
+}
+
+void quote_fetcher::cancel_transfers()
+{
+    // called with the lock held
+
+    for (auto id : m_cancelled) {
+        for (auto& t : m_transfers) {
+            if (t->active && t->id == id)
+                cancel(t.get());
+        }
+    }
+    m_cancelled.clear();
+}
+
+void quote_fetcher::add_started()
+{
+    // a fetch cancelled since these were launched is dropped before it reaches the server;
+    // any later fetch for the same quote is still queued, and cancel_transfers runs before it
+    // can start
+
+    std::unique_lock<std::mutex> lock { m_mutex };
+
+    const auto now = std::chrono::steady_clock::now();
+
+    for (auto t : m_started) {
+        if (std::find(std::begin(m_cancelled), std::end(m_cancelled), t->id) != std::end(m_cancelled)) {
+            release(t);
+            continue;
+        }
+
+        t->request.start();
+        t->started = now;
+        t->active = true;
+        curl_multi_add_handle(m_multi, t->request.handle());
+        ++m_running;
+    }
+    m_started.clear();
+}
+
+quote_fetcher::transfer *quote_fetcher::get_transfer()
+{
+    // max_requests can shrink on a config reload, so count what's in use rather than what exists
+
+    if (static_cast<int>(m_transfers.size() - m_idle_transfers.size()) >= m_max_requests)
+        return nullptr;
+
+    transfer *t;
+
+    if (!m_idle_transfers.empty()) {
+        t = m_idle_transfers.back();
+        m_idle_transfers.pop_back();
+    } else {
+        m_transfers.emplace_back(new transfer);
+        t = m_transfers.back().get();
+        t->request.set_share(m_share);
+    }
+
+    t->active = false;
+    t->sibling = nullptr;
+    return t;
+}
 
-                    m_window.set_quote_state(symbol, last, change, change_percent);
-                } else {
-                    m_window.set_quote_error(symbol);
+void quote_fetcher::launch(transfer *t, size_t provider)
+{
+    // called with the lock held; the handle is added by add_started
+
+    t->provider = provider;
+    t->tried |= 1u << provider;
+
+    auto& urls = m_urls[t->id];
+    if (urls.size() < m_providers.size())
+        urls.resize(m_providers.size());
+    if (urls[provider].empty())
+        urls[provider] = m_providers[provider]->provider->url(m_symbols[t->id]);
+    t->request.set_url(urls[provider]);
+
+    // whatever is left of the fetch's budget; a hedge or failover doesn't get a fresh one
+    const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(t->deadline - std::chrono::steady_clock::now());
+    t->request.set_timeouts(m_connect_timeout, std::max(remaining, std::chrono::milliseconds { 1 }));
+
+    // validators only mean something to the provider that handed them out
+    const auto& v = m_validators[t->id];
+    if (v.provider == provider)
+        t->request.set_validators(v.etag, v.last_modified);
+    else
+        t->request.set_validators(std::string {}, std::string {});
+
+    m_started.push_back(t);
+}
+
+void quote_fetcher::cancel(transfer *t)
+{
+    curl_multi_remove_handle(m_multi, t->request.handle());
+    --m_running;
+    release(t);
+}
+
+void quote_fetcher::release(transfer *t)
+{
+    if (t->sibling)
+        t->sibling->sibling = nullptr;
+    t->sibling = nullptr;
+    t->active = false;
+    m_idle_transfers.push_back(t);
+}
+
+bool quote_fetcher::next_provider(uint32_t tried, size_t& provider) const
+{
+    for (auto p : m_order) {
+        if (!(tried & (1u << p))) {
+            provider = p;
+            return true;
+        }
+    }
+    return false;
+}
+
+std::chrono::microseconds quote_fetcher::hedge_delay(size_t provider) const
+{
+    // until there's enough history for a p95, only hedge requests that are plainly stuck
+
+    const auto& latency = m_providers[provider]->latency;
+    if (latency.count() < HEDGE_MIN_SAMPLES)
+        return std::chrono::seconds { 2 };
+    return std::chrono::microseconds { latency.percentile(.95) };
+}
+
+void quote_fetcher::start_hedges()
+{
+    if (m_providers.size() < 2)
+        return;
+
+    const auto now = std::chrono::steady_clock::now();
+
+    {
+        std::unique_lock<std::mutex> lock { m_mutex };
+
+        // get_transfer may append to m_transfers; the new ones don't need looking at
+        for (size_t i = 0, count = m_transfers.size(); i < count; ++i) {
+            transfer *t { m_transfers[i].get() };
+
+            if (!t->active || t->hedged || now - t->started < hedge_delay(t->provider))
+                continue;
+
+            if (t->deadline <= now + MIN_ATTEMPT) {
+                t->hedged = true;
+                continue;
+            }
+
+            size_t provider;
+            if (!next_provider(t->tried, provider)) {
+                t->hedged = true;
+                continue;
+            }
+
+            transfer *h { get_transfer() };
+            if (!h)
+                break;
+
+            h->id = t->id;
+            h->deadline = t->deadline;
+            h->tried = t->tried;
+            h->hedged = true;
+            h->hedge = true;
+            launch(h, provider);
+
+            t->tried = h->tried;
+            t->hedged = true;
+            t->sibling = h;
+            h->sibling = t;
+
+            if (m_stats)
+                m_stats->record_hedge();
+        }
+    }
+
+    add_started();
+}
+
+int quote_fetcher::next_hedge_timeout() const
+{
+    int timeout { 1000 };
+
+    if (m_providers.size() < 2)
+        return timeout;
+
+    const auto now = std::chrono::steady_clock::now();
+
+    for (const auto& t : m_transfers) {
+        if (!t->active || t->hedged)
+            continue;
+
+        const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(t->started + hedge_delay(t->provider) - now).count();
+        timeout = std::min<int>(timeout, std::max<int>(remaining + 1, 0));
+    }
+
+    return timeout;
+}
+
+int quote_fetcher::finish_transfers()
+{
+    int finished { 0 };
+    int queued;
+
+    while (CURLMsg *message = curl_multi_info_read(m_multi, &queued)) {
+        if (message->msg != CURLMSG_DONE)
+            continue;
+
+        CURL *handle { message->easy_handle };
+        const CURLcode result { message->data.result };
+
+        curl_multi_remove_handle(m_multi, handle);
+
+        const auto request = curl_request::from_handle(handle);
+
+        auto it = std::find_if(std::begin(m_transfers),
+                               std::end(m_transfers),
+                               [&](const std::unique_ptr<transfer>& t) { return &t->request == request; });
+
+        // a hedge loser cancelled earlier in this batch
+        if (it == std::end(m_transfers) || !(*it)->active)
+            continue;
+
+        transfer *t { it->get() };
+        t->active = false;
+        ++finished;
+
+        const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - t->started);
+
+        if (handle_response(*t, result)) {
+            update_health(t->provider, true, elapsed.count());
+
+            if (t->sibling) {
+                // the primary was beaten by its hedge: it's slow, and that counts against it
+                if (t->hedge) {
+                    update_health(t->sibling->provider, false, 0);
+                    if (m_stats)
+                        m_stats->record_hedge_win();
                 }
+                cancel(t->sibling);
             }
-        } }
-    , m_done { false }
+
+            release(t);
+            continue;
+        }
+
+        update_health(t->provider, false, 0);
+
+        size_t provider;
+
+        if (t->sibling) {
+            // the other half may still answer
+            release(t);
+        } else if (t->deadline > std::chrono::steady_clock::now() + MIN_ATTEMPT && next_provider(t->tried, provider)) {
+            if (m_stats)
+                m_stats->record_failover();
+
+            {
+                std::unique_lock<std::mutex> lock { m_mutex };
+                t->hedge = false;
+                t->hedged = false;
+                launch(t, provider);
+            }
+            add_started();
+        } else {
+            m_sink.set_quote_error(t->id);
+            release(t);
+        }
+    }
+
+    return finished;
+}
+
+void quote_fetcher::update_health(size_t provider, bool answered, uint64_t micros)
 {
+    auto& state = *m_providers[provider];
+
+    if (answered)
+        state.latency.record(micros);
+
+    // demote after a run of failures or when most recent requests fail; only restore once
+    // it's answering reliably again
+
+    const double alpha { 0.2 };
+    state.failure_rate += alpha*((answered ? 0.0 : 1.0) - state.failure_rate);
+    state.consecutive_failures = answered ? 0 : state.consecutive_failures + 1;
+
+    const bool demoted { state.demoted ?
+            !(answered && state.failure_rate < 0.25) :
+            state.consecutive_failures >= FAILURE_LIMIT || state.failure_rate > 0.5 };
+
+    if (demoted == state.demoted)
+        return;
+
+    state.demoted = demoted;
+    std::cerr << "quote provider " << state.provider->name() << (demoted ? " demoted" : " restored") << "\n";
+
+    std::stable_sort(std::begin(m_order), std::end(m_order),
+                     [&](size_t a, size_t b) { return !m_providers[a]->demoted && m_providers[b]->demoted; });
 }
 
-quote_fetcher::~quote_fetcher()
+namespace {
+
+uint64_t micros_since(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+}
+
+bool quote_fetcher::handle_response(transfer& t, CURLcode result)
 {
+    auto& request = t.request;
+
+    if (!request.finish(result)) {
+        if (m_stats)
+            m_stats->record_error(t.id, fetch_error::NETWORK);
+        return false;
+    }
+
+    if (m_stats)
+        record_timings(t);
+
+    if (request.response_code() == 304) {
+        // nothing changed since the last full response: no body to parse, nothing to redraw
+
+        if (m_stats) {
+            std::unique_lock<std::mutex> lock { m_mutex };
+            m_stats->record_not_modified(m_validators[t.id].body_size);
+        }
+        if (m_recording)
+            record_response(t, true);
+        m_sink.set_quote_unchanged(t.id);
+        return true;
+    }
+
+    if (request.response_code() != 200) {
+        if (m_stats)
+            m_stats->record_error(t.id, fetch_error::HTTP);
+        return false;
+    }
+
+    const auto& buffer = request.buffer();
+
+    if (m_recording)
+        record_response(t, false);
+
+    if (!deliver(t.id, t.provider, buffer.data(), buffer.size()))
+        return false;
+
     {
         std::unique_lock<std::mutex> lock { m_mutex };
-        m_done = true;
+        auto& v = m_validators[t.id];
+        v.etag = request.etag();
+        v.last_modified = request.last_modified();
+        v.provider = t.provider;
+        v.body_size = buffer.size();
     }
-    m_condition.notify_one();
-    m_thread.join();
+
+    return true;
+}
+
+bool quote_fetcher::deliver(quote_id id, size_t provider, const char *data, size_t size)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    quote_values values;
+
+    if (m_providers[provider]->provider->decode(data, size, values) != parse_result::OK) {
+        if (m_stats)
+            m_stats->record_error(id, fetch_error::PARSE);
+        return false;
+    }
+
+    if (m_stats) {
+        m_stats->record_parse(micros_since(start));
+        start = std::chrono::steady_clock::now();
+    }
+
+    m_sink.set_quote_state(id, values.last, values.change, values.percent_change);
+
+    if (m_stats)
+        m_stats->record_publish(micros_since(start));
+
+    return true;
 }
 
-void quote_fetcher::fetch(const std::string& symbol)
+void quote_fetcher::record_response(const transfer& t, bool not_modified)
 {
+    std::string symbol;
     {
         std::unique_lock<std::mutex> lock { m_mutex };
-        m_queue.push_back(symbol);
+        symbol = m_symbols[t.id];
     }
-    m_condition.notify_one();
+
+    const auto now = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch());
+    const auto& body = t.request.buffer();
+
+    m_recorder.write(now.count(), t.provider, not_modified, symbol, body.data(), not_modified ? 0 : body.size());
+}
+
+void quote_fetcher::record_timings(const transfer& t)
+{
+    CURL *handle { t.request.handle() };
+
+    curl_off_t dns { 0 }, connect { 0 }, tls { 0 }, first_byte { 0 }, total { 0 }, bytes { 0 };
+    curl_easy_getinfo(handle, CURLINFO_NAMELOOKUP_TIME_T, &dns);
+    curl_easy_getinfo(handle, CURLINFO_CONNECT_TIME_T, &connect);
+    curl_easy_getinfo(handle, CURLINFO_APPCONNECT_TIME_T, &tls);
+    curl_easy_getinfo(handle, CURLINFO_STARTTRANSFER_TIME_T, &first_byte);
+    curl_easy_getinfo(handle, CURLINFO_TOTAL_TIME_T, &total);
+    curl_easy_getinfo(handle, CURLINFO_SIZE_DOWNLOAD_T, &bytes); // as received, before decoding
+
+    // curl reports cumulative times since the start of the transfer; keep each phase on its own
+
+    fetch_stats::timings timings;
+    timings.dns = dns;
+    timings.connect = connect > dns ? connect - dns : 0;
+    timings.tls = tls > connect ? tls - connect : 0;
+    timings.first_byte = first_byte > std::max(tls, connect) ? first_byte - std::max(tls, connect) : 0;
+    timings.total = total;
+    timings.bytes = bytes;
+    timings.decoded_bytes = t.request.buffer().size();
+
+    m_stats->record_fetch(t.id, timings);
 }
@@ -2,30 +2,136 @@
 
 #include <thread>
 #include <mutex>
+#include <chrono>
 #include <condition_variable>
 
 #include <string>
-#include <list>
+#include <vector>
+#include <memory>
 
-#include <boost/core/noncopyable.hpp>
+#include <curl/curl.h>
 
-#include "wm_window.h"
+#include <boost/core/noncopyable.hpp>
 
-class wm_window;
+#include "curl_request.h"
+#include "quote_log.h"
+#include "quote_provider.h"
+#include "quote_table.h"
+#include "fetch_stats.h"
+#include "quote_sink.h"
 
 class quote_fetcher : private boost::noncopyable
 {
 public:
-    quote_fetcher(wm_window& window);
+    quote_fetcher(quote_sink& sink);
     ~quote_fetcher();
 
-    void fetch(const std::string& quote);
+    // in order of preference; all providers must be added before the first fetch
+    void add_provider(std::unique_ptr<quote_provider> provider);
+    void set_max_requests(int max_requests);
+    void set_timeouts(long connect_timeout, long timeout);
+    void set_stats(fetch_stats *stats);
+    void add_quote(quote_id id, const std::string& symbol);
+
+    // the fetch, including any failover and hedge, fails if it hasn't answered within budget
+    // (capped at the timeout set above)
+    void fetch(quote_id id, std::chrono::milliseconds budget);
+
+    // drops a queued or in-flight fetch without telling the sink
+    void cancel(quote_id id);
+
+    // appends every response body to a log that replay() can feed back in
+    bool record(const std::string& path);
+
+    // delivers the logged responses instead of fetching, speed times as fast as they were
+    // recorded or as fast as possible if speed is 0; the log must outlive the fetcher
+    void replay(quote_log_reader& log, double speed);
 
 private:
-    wm_window& m_window;
-    std::thread m_thread;
-    std::list<std::string> m_queue;
-    bool m_done;
+    // A fetch starts on the preferred provider. If that takes longer than the provider's
+    // p95 a hedge goes to the next one and whichever answers first wins; if it fails, the
+    // fetch fails over to the next provider not yet tried.
+    struct transfer
+    {
+        curl_request request;
+        quote_id id;
+        size_t provider;
+        uint32_t tried;     // providers tried by this fetch, as a bit mask
+        bool active;
+        bool hedged;        // this fetch already has, or can't have, a hedge
+        bool hedge;         // this is the hedge
+        transfer *sibling;  // the other half of a hedged fetch, while still in flight
+        std::chrono::steady_clock::time_point started;
+        std::chrono::steady_clock::time_point deadline;
+    };
+
+    // what the last full response for a quote looked like, for conditional requests
+    struct validators
+    {
+        std::string etag;
+        std::string last_modified;
+        size_t provider = 0;
+        size_t body_size = 0;
+    };
+
+    struct provider_state
+    {
+        std::unique_ptr<quote_provider> provider;
+        latency_histogram latency; // answered requests, in microseconds
+        double failure_rate = 0;   // moving average; losing to a hedge counts as a failure
+        int consecutive_failures = 0;
+        bool demoted = false;
+    };
+
+    void run();
+    void run_replay(quote_log_reader& log, double speed);
+    bool start_transfers();
+    void cancel_transfers();
+    int finish_transfers();
+    void start_hedges();
+    int next_hedge_timeout() const;
+    transfer *get_transfer();
+    void launch(transfer *t, size_t provider);
+    void add_started();
+    void cancel(transfer *t);
+    void release(transfer *t);
+    bool next_provider(uint32_t tried, size_t& provider) const;
+    std::chrono::microseconds hedge_delay(size_t provider) const;
+    void update_health(size_t provider, bool answered, uint64_t micros);
+    bool handle_response(transfer& t, CURLcode result);
+    bool deliver(quote_id id, size_t provider, const char *data, size_t size);
+    void record_response(const transfer& t, bool not_modified);
+    void record_timings(const transfer& t);
+
+    static const int FAILURE_LIMIT = 3;
+    static const int HEDGE_MIN_SAMPLES = 20;
+
+    quote_sink& m_sink;
+    CURLM *m_multi;
+    CURLSH *m_share;
+    std::vector<std::unique_ptr<transfer>> m_transfers;
+    std::vector<transfer *> m_idle_transfers;
+    std::vector<transfer *> m_started;
+    int m_running = 0;
+    std::vector<std::unique_ptr<provider_state>> m_providers;
+    std::vector<size_t> m_order; // providers by preference, demoted ones last
+    fetch_stats *m_stats = nullptr;
+    std::vector<std::string> m_symbols;
+    std::vector<std::vector<std::string>> m_urls; // per quote and provider, built on first use
+    std::vector<validators> m_validators;
+    long m_connect_timeout = 10;
+    long m_timeout = 30;
+    std::vector<quote_id> m_queue;
+    std::vector<std::chrono::steady_clock::time_point> m_deadlines; // of queued fetches
+    std::vector<quote_id> m_cancelled;
+    int m_max_requests = 8;
+    bool m_done = false;
     std::mutex m_mutex;
     std::condition_variable m_condition;
+    std::thread m_thread;
+
+    quote_log_writer m_recorder;
+    bool m_recording = false;
+    std::condition_variable m_replay_condition;
+    std::thread m_replay_thread;
 };
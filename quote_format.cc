@@ -0,0 +1,58 @@
+#include "quote_format.h"
+
+namespace {
+
+// writes value into buf (at least 21 bytes), optionally zero-padded to min_digits and with
+// a forced sign; returns the number of characters written
+int format_integer(char *buf, long value, int min_digits, bool force_sign)
+{
+    char digits[20];
+    int count { 0 };
+
+    unsigned long magnitude { value < 0 ? 0ul - static_cast<unsigned long>(value) : static_cast<unsigned long>(value) };
+    do {
+        digits[count++] = '0' + magnitude%10;
+        magnitude /= 10;
+    } while (magnitude);
+
+    while (count < min_digits)
+        digits[count++] = '0';
+
+    char *p { buf };
+    if (value < 0)
+        *p++ = '-';
+    else if (force_sign)
+        *p++ = '+';
+
+    while (count)
+        *p++ = digits[--count];
+    *p = '\0';
+
+    return p - buf;
+}
+
+}
+
+void format_quote(decimal last, decimal change, decimal percent_change, quote_text& text)
+{
+    if (last.units() >= 100*decimal::SCALE) {
+        const long ilast { last.round(0) };
+        const long ichange { change.round(0) };
+
+        if (ilast >= 1000) {
+            const int length { format_integer(text.last, ilast/1000, 0, false) };
+            text.last[length] = ',';
+            format_integer(text.last + length + 1, ilast%1000, 3, false);
+        } else {
+            format_integer(text.last, ilast, 0, false);
+        }
+        format_integer(text.change, ichange, 0, true);
+    } else {
+        format_decimal(text.last, last, 2, false);
+        format_decimal(text.change, change, 2, true);
+    }
+
+    const int length { format_decimal(text.percent_change, percent_change, 2, true) };
+    text.percent_change[length] = '%';
+    text.percent_change[length + 1] = '\0';
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "decimal.h"
+
+// Display strings for a quote, formatted once when it arrives. Prices of 100 and up are
+// rounded to integers with a thousands separator, smaller ones get two decimals. Rounding is
+// half away from zero on the exact decimal value, so it differs from what draw_quote used to
+// get out of boost::format on doubles at ties (0.125 is now +0.13, not +0.12; 1.005 is +1.01)
+// and on tiny negatives, which now show as +0.00 rather than -0.00.
+
+struct quote_text
+{
+    static const int SIZE = 24;
+
+    char last[SIZE];
+    char change[SIZE];
+    char percent_change[SIZE];
+};
+
+void format_quote(decimal last, decimal change, decimal percent_change, quote_text& text);
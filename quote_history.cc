@@ -0,0 +1,49 @@
+#include <algorithm>
+
+#include "quote_history.h"
+
+void quote_history::set_capacity(size_t capacity)
+{
+    // only before any quotes are added, the arena layout depends on it
+    if (m_head.empty())
+        m_capacity = std::max<size_t>(capacity, 1);
+}
+
+void quote_history::add_quote()
+{
+    m_samples.resize(m_samples.size() + m_capacity);
+    m_head.push_back(0);
+    m_count.push_back(0);
+    m_serial.push_back(0);
+}
+
+void quote_history::push(quote_id id, time_t time, decimal price)
+{
+    auto& head = m_head[id];
+    m_samples[id*m_capacity + head] = { time, price };
+
+    if (++head == m_capacity)
+        head = 0;
+
+    if (m_count[id] < m_capacity)
+        ++m_count[id];
+
+    ++m_serial[id];
+}
+
+size_t quote_history::size(quote_id id) const
+{
+    return m_count[id];
+}
+
+const quote_history::sample& quote_history::at(quote_id id, size_t index) const
+{
+    // index 0 is the oldest sample still kept
+    const size_t first { (m_head[id] + m_capacity - m_count[id])%m_capacity };
+    return m_samples[id*m_capacity + (first + index)%m_capacity];
+}
+
+uint32_t quote_history::serial(quote_id id) const
+{
+    return m_serial[id];
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <ctime>
+#include <cstdint>
+#include <vector>
+
+#include "decimal.h"
+#include "quote_table.h"
+
+// Fixed-capacity ring of (time, price) samples per quote. All rings live back to back in a
+// single arena sized capacity*quotes, so recording a sample never allocates.
+
+class quote_history
+{
+public:
+    struct sample
+    {
+        time_t time;
+        decimal price;
+    };
+
+    void set_capacity(size_t capacity);
+    void add_quote();
+
+    void push(quote_id id, time_t time, decimal price);
+    size_t size(quote_id id) const;
+    const sample& at(quote_id id, size_t index) const;
+    uint32_t serial(quote_id id) const;
+
+private:
+    size_t m_capacity = 256;
+    std::vector<sample> m_samples;
+    std::vector<uint32_t> m_head;
+    std::vector<uint32_t> m_count;
+    std::vector<uint32_t> m_serial;
+};
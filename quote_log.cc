@@ -0,0 +1,173 @@
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <unordered_set>
+
+#include "quote_log.h"
+
+namespace {
+
+const char log_magic[8] { 'w', 'm', 'i', 'b', 'o', 'v', 'l', '\0' };
+const uint32_t log_version { 1 };
+
+const size_t header_size { sizeof(log_magic) + sizeof(log_version) };
+const size_t record_header_size { sizeof(int64_t) + sizeof(uint32_t) + 3 };
+const uint8_t not_modified_flag { 1 };
+
+}
+
+quote_log_writer::~quote_log_writer()
+{
+    if (m_fd != -1)
+        close(m_fd);
+}
+
+bool quote_log_writer::open(const std::string& path)
+{
+    m_fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (m_fd == -1) {
+        std::cerr << "failed to open " << path << ": " << strerror(errno) << "\n";
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(m_fd, &st) == 0 && st.st_size == 0) {
+        char header[header_size];
+        memcpy(header, log_magic, sizeof(log_magic));
+        memcpy(header + sizeof(log_magic), &log_version, sizeof(log_version));
+        ::write(m_fd, header, sizeof(header));
+    }
+
+    return true;
+}
+
+void quote_log_writer::write(int64_t time, size_t provider, bool not_modified, const std::string& symbol, const char *body, size_t size)
+{
+    if (m_fd == -1 || symbol.size() > UINT8_MAX || size > UINT32_MAX)
+        return;
+
+    const uint32_t body_size = size;
+    const uint8_t provider_index = std::min<size_t>(provider, UINT8_MAX);
+    const uint8_t symbol_size = symbol.size();
+
+    m_buffer.resize(record_header_size + symbol.size() + size);
+
+    char *p { m_buffer.data() };
+    memcpy(p, &time, sizeof(time));
+    p += sizeof(time);
+    memcpy(p, &body_size, sizeof(body_size));
+    p += sizeof(body_size);
+    *p++ = provider_index;
+    *p++ = not_modified ? not_modified_flag : 0;
+    *p++ = symbol_size;
+    memcpy(p, symbol.data(), symbol.size());
+    p += symbol.size();
+    memcpy(p, body, size);
+
+    if (::write(m_fd, m_buffer.data(), m_buffer.size()) != static_cast<ssize_t>(m_buffer.size()))
+        std::cerr << "failed to record response for " << symbol << "\n";
+}
+
+quote_log_reader::~quote_log_reader()
+{
+    if (m_data)
+        munmap(const_cast<char *>(m_data), m_size);
+}
+
+bool quote_log_reader::open(const std::string& path)
+{
+    const int fd { ::open(path.c_str(), O_RDONLY | O_CLOEXEC) };
+    if (fd == -1) {
+        std::cerr << "failed to open " << path << ": " << strerror(errno) << "\n";
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) == -1 || static_cast<size_t>(st.st_size) < header_size) {
+        std::cerr << path << " is not a quote log\n";
+        close(fd);
+        return false;
+    }
+
+    void *data { mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0) };
+    close(fd);
+
+    if (data == MAP_FAILED) {
+        std::cerr << "failed to map " << path << "\n";
+        return false;
+    }
+
+    m_data = static_cast<const char *>(data);
+    m_size = st.st_size;
+
+    uint32_t version;
+    memcpy(&version, m_data + sizeof(log_magic), sizeof(version));
+
+    if (memcmp(m_data, log_magic, sizeof(log_magic)) != 0 || version != log_version) {
+        std::cerr << path << " is not a quote log\n";
+        munmap(data, m_size);
+        m_data = nullptr;
+        return false;
+    }
+
+    madvise(data, m_size, MADV_SEQUENTIAL);
+
+    m_pos = header_size;
+    return true;
+}
+
+std::vector<std::string> quote_log_reader::symbols()
+{
+    std::vector<std::string> symbols;
+    std::unordered_set<std::string> seen;
+
+    const size_t pos { m_pos };
+    rewind();
+
+    record r;
+    while (next(r)) {
+        if (seen.insert(r.symbol).second)
+            symbols.push_back(r.symbol);
+    }
+
+    m_pos = pos;
+    return symbols;
+}
+
+bool quote_log_reader::next(record& r)
+{
+    if (!m_data || m_size - m_pos < record_header_size)
+        return false;
+
+    const char *p { m_data + m_pos };
+
+    uint32_t body_size;
+    memcpy(&r.time, p, sizeof(r.time));
+    p += sizeof(r.time);
+    memcpy(&body_size, p, sizeof(body_size));
+    p += sizeof(body_size);
+    r.provider = static_cast<uint8_t>(*p++);
+    r.not_modified = *p++ & not_modified_flag;
+    const size_t symbol_size { static_cast<uint8_t>(*p++) };
+
+    if (m_size - m_pos - record_header_size < symbol_size + body_size)
+        return false;
+
+    r.symbol.assign(p, symbol_size);
+    r.body = p + symbol_size;
+    r.size = body_size;
+
+    m_pos += record_header_size + symbol_size + body_size;
+    return true;
+}
+
+void quote_log_reader::rewind()
+{
+    m_pos = header_size;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <boost/core/noncopyable.hpp>
+
+// Append-only binary log of raw quote responses, written by --record and read back by
+// --replay. After an 8-byte magic and a version, each record is
+//
+//     int64_t  time, microseconds since the epoch
+//     uint32_t body size
+//     uint8_t  provider index
+//     uint8_t  flags, 1 if the response was a 304 (with no body)
+//     uint8_t  symbol size
+//     symbol, then body
+//
+// in host byte order. A record is written with a single write(), so a crash leaves at most
+// one truncated record at the end, which the reader ignores.
+
+class quote_log_writer : private boost::noncopyable
+{
+public:
+    quote_log_writer() = default;
+    ~quote_log_writer();
+
+    bool open(const std::string& path);
+    void write(int64_t time, size_t provider, bool not_modified, const std::string& symbol, const char *body, size_t size);
+
+private:
+    std::vector<char> m_buffer;
+    int m_fd = -1;
+};
+
+class quote_log_reader : private boost::noncopyable
+{
+public:
+    struct record
+    {
+        int64_t time;
+        size_t provider;
+        bool not_modified;
+        std::string symbol;
+        const char *body;
+        size_t size;
+    };
+
+    quote_log_reader() = default;
+    ~quote_log_reader();
+
+    // maps the whole log
+    bool open(const std::string& path);
+
+    // every symbol in the log, in order of first appearance
+    std::vector<std::string> symbols();
+
+    // false at the end of the log
+    bool next(record& r);
+    void rewind();
+
+private:
+    const char *m_data = nullptr;
+    size_t m_size = 0;
+    size_t m_pos = 0;
+};
@@ -0,0 +1,323 @@
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+
+#include "quote_parser.h"
+
+namespace {
+
+const int MAX_DEPTH { 64 };
+
+class json_scanner
+{
+public:
+    json_scanner(const char *data, size_t size)
+        : m_pos { data }
+        , m_end { data + size }
+    { }
+
+    bool at_end()
+    {
+        skip_whitespace();
+        return m_pos == m_end;
+    }
+
+    bool consume(char ch)
+    {
+        skip_whitespace();
+        if (m_pos == m_end || *m_pos != ch)
+            return false;
+        ++m_pos;
+        return true;
+    }
+
+    char peek()
+    {
+        skip_whitespace();
+        return m_pos == m_end ? '\0' : *m_pos;
+    }
+
+    // contents of a string without the quotes; escapes are left as they are
+    bool string(const char *& begin, const char *& end, bool& escaped)
+    {
+        if (!consume('"'))
+            return false;
+
+        begin = m_pos;
+        escaped = false;
+
+        while (m_pos != m_end) {
+            const char ch { *m_pos };
+
+            if (ch == '"') {
+                end = m_pos++;
+                return true;
+            } else if (ch == '\\') {
+                escaped = true;
+                if (++m_pos == m_end || !escape())
+                    return false;
+                continue;
+            } else if (static_cast<unsigned char>(ch) < 0x20) {
+                return false;
+            }
+
+            ++m_pos;
+        }
+
+        return false;
+    }
+
+    // a JSON number: -?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)?
+    bool number(const char *& begin, const char *& end)
+    {
+        skip_whitespace();
+
+        begin = m_pos;
+
+        if (m_pos != m_end && *m_pos == '-')
+            ++m_pos;
+
+        if (m_pos != m_end && *m_pos == '0')
+            ++m_pos;
+        else if (!digits())
+            return fail(begin);
+
+        if (m_pos != m_end && *m_pos == '.') {
+            ++m_pos;
+            if (!digits())
+                return fail(begin);
+        }
+
+        if (m_pos != m_end && (*m_pos == 'e' || *m_pos == 'E')) {
+            ++m_pos;
+            if (m_pos != m_end && (*m_pos == '+' || *m_pos == '-'))
+                ++m_pos;
+            if (!digits())
+                return fail(begin);
+        }
+
+        end = m_pos;
+        return true;
+    }
+
+    bool skip_value(int depth)
+    {
+        if (depth > MAX_DEPTH)
+            return false;
+
+        const char *begin, *end;
+        bool escaped;
+
+        switch (peek()) {
+        case '"':
+            return string(begin, end, escaped);
+
+        case '{':
+            ++m_pos;
+            if (consume('}'))
+                return true;
+            do {
+                if (!string(begin, end, escaped) || !consume(':') || !skip_value(depth + 1))
+                    return false;
+            } while (consume(','));
+            return consume('}');
+
+        case '[':
+            ++m_pos;
+            if (consume(']'))
+                return true;
+            do {
+                if (!skip_value(depth + 1))
+                    return false;
+            } while (consume(','));
+            return consume(']');
+
+        case 't':
+            return literal("true");
+
+        case 'f':
+            return literal("false");
+
+        case 'n':
+            return literal("null");
+
+        default:
+            return number(begin, end);
+        }
+    }
+
+private:
+    void skip_whitespace()
+    {
+        while (m_pos != m_end && (*m_pos == ' ' || *m_pos == '\t' || *m_pos == '\n' || *m_pos == '\r'))
+            ++m_pos;
+    }
+
+    bool literal(const char *text)
+    {
+        const size_t length { strlen(text) };
+        if (static_cast<size_t>(m_end - m_pos) < length || memcmp(m_pos, text, length) != 0)
+            return false;
+        m_pos += length;
+        return true;
+    }
+
+    // the rest of an escape, after the backslash
+    bool escape()
+    {
+        const char ch { *m_pos++ };
+
+        if (ch != 'u')
+            return strchr("\"\\/bfnrt", ch) != nullptr && ch != '\0';
+
+        for (int i = 0; i < 4; ++i, ++m_pos) {
+            if (m_pos == m_end || !isxdigit(static_cast<unsigned char>(*m_pos)))
+                return false;
+        }
+        return true;
+    }
+
+    // at least one
+    bool digits()
+    {
+        const char *begin { m_pos };
+        while (m_pos != m_end && *m_pos >= '0' && *m_pos <= '9')
+            ++m_pos;
+        return m_pos != begin;
+    }
+
+    bool fail(const char *pos)
+    {
+        m_pos = pos;
+        return false;
+    }
+
+    const char *m_pos;
+    const char *m_end;
+};
+
+bool key_equals(const char *begin, const char *end, const std::string& key)
+{
+    return static_cast<size_t>(end - begin) == key.size() && memcmp(begin, key.data(), key.size()) == 0;
+}
+
+}
+
+parse_result parse_quote(const char *data, size_t size, quote_values& values, const quote_fields& keys)
+{
+    struct field
+    {
+        const std::string& key;
+        decimal *value;
+        bool seen;
+    } fields[] {
+        { keys.last, &values.last, false },
+        { keys.change, &values.change, false },
+        { keys.percent_change, &values.percent_change, false },
+    };
+
+    values = quote_values {};
+
+    json_scanner scanner { data, size };
+
+    if (scanner.peek() != '{')
+        return scanner.at_end() ? parse_result::MALFORMED_JSON : parse_result::NOT_AN_OBJECT;
+
+    scanner.consume('{');
+
+    if (!scanner.consume('}')) {
+        do {
+            const char *key_begin, *key_end;
+            bool escaped;
+
+            if (!scanner.string(key_begin, key_end, escaped) || !scanner.consume(':'))
+                return parse_result::MALFORMED_JSON;
+
+            field *wanted { nullptr };
+            if (!escaped) {
+                for (auto& f : fields) {
+                    if (!f.seen && key_equals(key_begin, key_end, f.key)) {
+                        wanted = &f;
+                        break;
+                    }
+                }
+            }
+
+            if (!wanted) {
+                if (!scanner.skip_value(1))
+                    return parse_result::MALFORMED_JSON;
+                continue;
+            }
+
+            const char *value_begin, *value_end;
+
+            if (scanner.peek() == '"') {
+                if (!scanner.string(value_begin, value_end, escaped))
+                    return parse_result::MALFORMED_JSON;
+                if (escaped)
+                    return parse_result::BAD_NUMBER;
+            } else if (!scanner.number(value_begin, value_end)) {
+                return scanner.skip_value(1) ? parse_result::BAD_NUMBER : parse_result::MALFORMED_JSON;
+            }
+
+            if (!parse_decimal(value_begin, value_end, *wanted->value))
+                return parse_result::BAD_NUMBER;
+
+            wanted->seen = true;
+        } while (scanner.consume(','));
+
+        if (!scanner.consume('}'))
+            return parse_result::MALFORMED_JSON;
+    }
+
+    if (!scanner.at_end())
+        return parse_result::MALFORMED_JSON;
+
+    return parse_result::OK;
+}
+
+bool parse_string_field(const char *data, size_t size, const std::string& key, std::string& value)
+{
+    json_scanner scanner { data, size };
+
+    if (!scanner.consume('{') || scanner.consume('}'))
+        return false;
+
+    do {
+        const char *key_begin, *key_end;
+        bool escaped;
+
+        if (!scanner.string(key_begin, key_end, escaped) || !scanner.consume(':'))
+            return false;
+
+        if (escaped || !key_equals(key_begin, key_end, key)) {
+            if (!scanner.skip_value(1))
+                return false;
+            continue;
+        }
+
+        const char *value_begin, *value_end;
+        if (scanner.peek() != '"' || !scanner.string(value_begin, value_end, escaped) || escaped)
+            return false;
+
+        value.assign(value_begin, value_end);
+        return true;
+    } while (scanner.consume(','));
+
+    return false;
+}
+
+const char *parse_result_string(parse_result result)
+{
+    switch (result) {
+    case parse_result::OK:
+        return "ok";
+    case parse_result::MALFORMED_JSON:
+        return "malformed json";
+    case parse_result::NOT_AN_OBJECT:
+        return "not an object";
+    case parse_result::BAD_NUMBER:
+        return "bad number";
+    }
+    return "unknown";
+}
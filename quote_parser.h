@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#include "decimal.h"
+
+struct quote_values
+{
+    decimal last;
+    decimal change;
+    decimal percent_change;
+};
+
+// keys the three values are found under
+struct quote_fields
+{
+    std::string last { "trdprc_1" };
+    std::string change { "netchng_1" };
+    std::string percent_change { "pctchng" };
+};
+
+enum class parse_result
+{
+    OK,
+    MALFORMED_JSON,
+    NOT_AN_OBJECT,
+    BAD_NUMBER,
+};
+
+// Pulls the three fields out of a quote response without building a tree or allocating.
+// Fields may be JSON numbers or strings holding numbers, and are read straight into
+// decimals; missing fields read as 0.
+parse_result parse_quote(const char *data, size_t size, quote_values& values, const quote_fields& fields = quote_fields {});
+
+// Top-level string field of a JSON object, as raw bytes; false if it's missing, not a plain
+// string or the object is malformed before it.
+bool parse_string_field(const char *data, size_t size, const std::string& key, std::string& value);
+
+const char *parse_result_string(parse_result result);
@@ -0,0 +1,29 @@
+#include "quote_provider.h"
+
+json_quote_provider::json_quote_provider(const std::string& name, const std::string& url, const quote_fields& fields)
+    : m_name { name }
+    , m_url { url }
+    , m_fields { fields }
+{
+}
+
+const std::string& json_quote_provider::name() const
+{
+    return m_name;
+}
+
+std::string json_quote_provider::url(const std::string& symbol) const
+{
+    static const std::string placeholder { "{symbol}" };
+
+    const auto pos = m_url.find(placeholder);
+    if (pos == std::string::npos)
+        return m_url + symbol;
+
+    return std::string { m_url }.replace(pos, placeholder.size(), symbol);
+}
+
+parse_result json_quote_provider::decode(const char *data, size_t size, quote_values& values) const
+{
+    return parse_quote(data, size, values, m_fields);
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <string>
+
+#include "quote_parser.h"
+
+// A source of quotes: how to ask it for a symbol and how to read its answer. Called from
+// the fetcher thread.
+
+class quote_provider
+{
+public:
+    virtual ~quote_provider() = default;
+
+    virtual const std::string& name() const = 0;
+    virtual std::string url(const std::string& symbol) const = 0;
+    virtual parse_result decode(const char *data, size_t size, quote_values& values) const = 0;
+};
+
+// Answers with a JSON object holding the values under configurable keys. The symbol goes
+// wherever the URL says {symbol}, or at the end if it doesn't.
+
+class json_quote_provider : public quote_provider
+{
+public:
+    json_quote_provider(const std::string& name, const std::string& url, const quote_fields& fields);
+
+    const std::string& name() const override;
+    std::string url(const std::string& symbol) const override;
+    parse_result decode(const char *data, size_t size, quote_values& values) const override;
+
+private:
+    std::string m_name;
+    std::string m_url;
+    quote_fields m_fields;
+};
@@ -0,0 +1,156 @@
+#include <algorithm>
+#include <cstring>
+
+#include "quote_renderer.h"
+
+namespace {
+
+// the font pixmap holds ' ' through '~' in ASCII order, 32 glyphs per row
+
+constexpr int glyph_index(char ch)
+{
+    return ch >= ' ' && ch <= '~' ? ch - ' ' : -1;
+}
+
+constexpr int glyph_column(char ch)
+{
+    return glyph_index(ch)%32;
+}
+
+constexpr int glyph_row(char ch)
+{
+    return glyph_index(ch)/32;
+}
+
+static_assert(glyph_index('~') == 94 && glyph_row('@') == 1 && glyph_column('@') == 0, "font layout");
+
+}
+
+bool same_frame(const quote_snapshot& a, const quote_snapshot& b)
+{
+    if (a.status != b.status || a.stale != b.stale)
+        return false;
+    if (a.status != quote_status::FETCHED && !a.stale)
+        return true;
+    return a.last == b.last && a.change == b.change && a.percent_change == b.percent_change;
+}
+
+quote_renderer::quote_renderer(const quote_table& quotes, const quote_history& history)
+    : m_quotes { quotes }
+    , m_history { history }
+{
+}
+
+void quote_renderer::compose(render_target& target, quote_id id, const quote_snapshot& quote, font_color flash) const
+{
+    target.clear();
+
+    const auto& symbol = m_quotes.symbol[id];
+
+    if (quote.status == quote_status::FETCHED || quote.stale) {
+        draw_quote(target, symbol, quote.change, quote.text, quote.stale, flash);
+        draw_sparkline(target, id);
+    } else if (quote.status == quote_status::NONE)
+        draw_wait(target, symbol);
+    else
+        draw_error(target, symbol);
+}
+
+void quote_renderer::draw_string(render_target& target, font_color font, const char *text, int x, int y) const
+{
+    for (; *text; ++text) {
+        const char ch { *text };
+
+        if (glyph_index(ch) != -1)
+            target.draw_glyph(font, glyph_column(ch), glyph_row(ch), x, y);
+
+        x += GLYPH_WIDTH;
+    }
+}
+
+void quote_renderer::draw_string_centered(render_target& target, font_color font, const char *text, int y) const
+{
+    draw_string(target, font, text, (WINDOW_SIZE - static_cast<int>(strlen(text))*GLYPH_WIDTH)/2, y);
+}
+
+void quote_renderer::draw_quote(render_target& target, const std::string& symbol, decimal change, const quote_text& text, bool stale, font_color flash) const
+{
+    int base_y { (WINDOW_SIZE - 4*GLYPH_HEIGHT)/2 };
+
+    // an alert overrides every color
+
+    const bool flashing { flash != font_color::NONE };
+
+    draw_string_centered(target, flashing ? flash : font_color::WHITE, symbol.c_str(), base_y);
+    base_y += GLYPH_HEIGHT;
+
+    draw_string_centered(target, flashing ? flash : stale ? font_color::YELLOW : font_color::WHITE, text.last, base_y);
+    base_y += GLYPH_HEIGHT;
+
+    const auto change_font = flashing ? flash : stale ? font_color::YELLOW : change > decimal {} ? font_color::GREEN : font_color::RED;
+    draw_string_centered(target, change_font, text.change, base_y);
+    base_y += GLYPH_HEIGHT;
+
+    draw_string_centered(target, change_font, text.percent_change, base_y);
+}
+
+void quote_renderer::draw_sparkline(render_target& target, quote_id id) const
+{
+    // most recent samples, one per column, in the strip below the text
+
+    const size_t size { m_history.size(id) };
+    const size_t count { std::min<size_t>(size, GRAPH_WIDTH) };
+
+    if (count < 2)
+        return;
+
+    const size_t first { size - count };
+
+    decimal min_price { m_history.at(id, first).price }, max_price { min_price };
+    for (size_t i = first + 1; i < size; ++i) {
+        const decimal price { m_history.at(id, i).price };
+        min_price = std::min(min_price, price);
+        max_price = std::max(max_price, price);
+    }
+
+    // rows are (max - price)/(max - min) of the height, rounded; unsigned differences can't
+    // overflow, and both are halved until multiplying by the height can't either
+
+    const uint64_t steps { GRAPH_HEIGHT - 1 };
+    const uint64_t span { static_cast<uint64_t>(max_price.units()) - static_cast<uint64_t>(min_price.units()) };
+
+    render_point points[GRAPH_WIDTH];
+
+    for (size_t i = 0; i < count; ++i) {
+        int y { GRAPH_HEIGHT/2 };
+
+        if (span) {
+            uint64_t offset { static_cast<uint64_t>(max_price.units()) - static_cast<uint64_t>(m_history.at(id, first + i).price.units()) };
+            uint64_t range { span };
+            while (range > UINT64_MAX/(2*steps)) {
+                offset >>= 1;
+                range >>= 1;
+            }
+            y = (offset*steps + range/2)/range;
+        }
+
+        points[i].x = GRAPH_LEFT + GRAPH_WIDTH - count + i;
+        points[i].y = GRAPH_TOP + y;
+    }
+
+    target.draw_lines(points, count);
+}
+
+void quote_renderer::draw_wait(render_target& target, const std::string& symbol) const
+{
+    const int base_y { (WINDOW_SIZE - 2*GLYPH_HEIGHT)/2 };
+    draw_string_centered(target, font_color::WHITE, symbol.c_str(), base_y);
+    draw_string_centered(target, font_color::YELLOW, "WAIT", base_y + GLYPH_HEIGHT);
+}
+
+void quote_renderer::draw_error(render_target& target, const std::string& symbol) const
+{
+    const int base_y { (WINDOW_SIZE - 2*GLYPH_HEIGHT)/2 };
+    draw_string_centered(target, font_color::WHITE, symbol.c_str(), base_y);
+    draw_string_centered(target, font_color::RED, "ERROR", base_y + GLYPH_HEIGHT);
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#include "quote_table.h"
+#include "quote_history.h"
+
+// Composes the 64x64 frame for a quote out of font glyphs and the sparkline, on whatever
+// surface a render_target draws to: an X pixmap in the dockapp, memory in tests and benchmarks.
+
+enum class font_color
+{
+    NONE,
+    WHITE,
+    GREEN,
+    RED,
+    YELLOW,
+};
+
+struct render_point
+{
+    int x, y;
+};
+
+class render_target
+{
+public:
+    virtual ~render_target() = default;
+
+    virtual void clear() = 0; // to black
+
+    // the glyph cell at column, row of the font pixmap, with its top left corner at x, y
+    virtual void draw_glyph(font_color font, int column, int row, int x, int y) = 0;
+
+    // connected lines in the graph color
+    virtual void draw_lines(const render_point *points, size_t count) = 0;
+};
+
+class quote_renderer
+{
+public:
+    quote_renderer(const quote_table& quotes, const quote_history& history);
+
+    // flash is the color an alert overrides every other one with, if any
+    void compose(render_target& target, quote_id id, const quote_snapshot& quote, font_color flash) const;
+
+    static const int WINDOW_SIZE = 64;
+    static const int GLYPH_WIDTH = 8;
+    static const int GLYPH_HEIGHT = 12;
+
+private:
+    void draw_string(render_target& target, font_color font, const char *text, int x, int y) const;
+    void draw_string_centered(render_target& target, font_color font, const char *text, int y) const;
+    void draw_quote(render_target& target, const std::string& symbol, decimal change, const quote_text& text, bool stale, font_color flash) const;
+    void draw_sparkline(render_target& target, quote_id id) const;
+    void draw_wait(render_target& target, const std::string& symbol) const;
+    void draw_error(render_target& target, const std::string& symbol) const;
+
+    const quote_table& m_quotes;
+    const quote_history& m_history;
+
+    static const int GRAPH_LEFT = 4;
+    static const int GRAPH_TOP = 56;
+    static const int GRAPH_WIDTH = 56;
+    static const int GRAPH_HEIGHT = 4;
+};
+
+// true if the two snapshots would be drawn the same
+bool same_frame(const quote_snapshot& a, const quote_snapshot& b);
@@ -0,0 +1,59 @@
+#include <algorithm>
+#include <functional>
+
+#include "quote_scheduler.h"
+
+void quote_scheduler::schedule(quote_id quote, time_t due)
+{
+    if (quote >= m_due.size())
+        m_due.resize(quote + 1, 0);
+    m_due[quote] = due;
+
+    m_heap.push_back({ due, quote });
+    std::push_heap(std::begin(m_heap), std::end(m_heap), std::greater<entry>());
+
+    drop_stale();
+}
+
+void quote_scheduler::cancel(quote_id quote)
+{
+    if (quote < m_due.size())
+        m_due[quote] = 0;
+
+    drop_stale();
+}
+
+bool quote_scheduler::pop_due(time_t now, quote_id& quote)
+{
+    if (m_heap.empty() || m_heap.front().due > now)
+        return false;
+
+    quote = m_heap.front().quote;
+    m_due[quote] = 0;
+    std::pop_heap(std::begin(m_heap), std::end(m_heap), std::greater<entry>());
+    m_heap.pop_back();
+
+    drop_stale();
+
+    return true;
+}
+
+void quote_scheduler::drop_stale()
+{
+    // keeps the front live, so that next_due is always accurate
+
+    while (!m_heap.empty() && m_due[m_heap.front().quote] != m_heap.front().due) {
+        std::pop_heap(std::begin(m_heap), std::end(m_heap), std::greater<entry>());
+        m_heap.pop_back();
+    }
+}
+
+time_t quote_scheduler::next_due() const
+{
+    return m_heap.empty() ? static_cast<time_t>(0) : m_heap.front().due;
+}
+
+bool quote_scheduler::empty() const
+{
+    return m_heap.empty();
+}
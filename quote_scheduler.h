@@ -0,0 +1,35 @@
+#pragma once
+
+#include <ctime>
+#include <vector>
+
+#include "quote_table.h"
+
+// min-heap of quote ids keyed on when each one is next due for a refresh. A quote is in at
+// most once: rescheduling or cancelling leaves the old entry behind to be skipped when it
+// comes up.
+
+class quote_scheduler
+{
+public:
+    void schedule(quote_id quote, time_t due);
+    void cancel(quote_id quote);
+    bool pop_due(time_t now, quote_id& quote);
+    time_t next_due() const;
+    bool empty() const;
+
+private:
+    struct entry
+    {
+        time_t due;
+        quote_id quote;
+
+        bool operator>(const entry& other) const
+        { return due > other.due; }
+    };
+
+    void drop_stale();
+
+    std::vector<entry> m_heap;
+    std::vector<time_t> m_due; // per quote, 0 if not scheduled
+};
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "quote_table.h"
+
+// Receives the outcome of each fetch. Called from the fetcher thread.
+
+class quote_sink
+{
+public:
+    virtual ~quote_sink() = default;
+
+    virtual void set_quote_state(quote_id id, decimal last, decimal change, decimal percent_change) = 0;
+    virtual void set_quote_unchanged(quote_id id) = 0;
+    virtual void set_quote_error(quote_id id) = 0;
+
+    // the replayed responses that follow were recorded at this time
+    virtual void set_replay_time(time_t time) = 0;
+
+    // a replayed log has been fed through completely
+    virtual void set_replay_done() = 0;
+};
@@ -0,0 +1,130 @@
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#include "quote_stream.h"
+
+quote_stream::quote_stream(quote_engine& engine)
+    : m_engine { engine }
+{
+    m_buffer.reserve(64*1024);
+}
+
+quote_stream::~quote_stream()
+{
+    if (m_owns_fd)
+        close(m_fd);
+}
+
+bool quote_stream::open(const std::string& path)
+{
+    // a reader going away should end the loop with EPIPE, not kill us
+    signal(SIGPIPE, SIG_IGN);
+
+    if (path.empty() || path == "-") {
+        m_fd = STDOUT_FILENO;
+        return true;
+    }
+
+    // a FIFO blocks here until there's a reader
+    m_fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (m_fd == -1) {
+        std::cerr << "failed to open " << path << ": " << strerror(errno) << "\n";
+        return false;
+    }
+
+    m_owns_fd = true;
+    return true;
+}
+
+bool quote_stream::run()
+{
+    m_engine.start();
+
+    while (!m_engine.stopped()) {
+        m_updated.clear();
+        m_engine.reschedule_completed(m_updated);
+
+        for (auto id : m_updated) {
+            if (!m_engine.quotes().hidden[id])
+                append(id);
+        }
+
+        if (!flush())
+            return false;
+
+        m_engine.schedule_updates();
+        m_engine.wait_for_events(-1);
+    }
+
+    return true;
+}
+
+void quote_stream::append(quote_id id)
+{
+    const auto& quotes = m_engine.quotes();
+    const auto quote = quotes.snapshot[id].load();
+
+    // a symbol just added by a config reload has nothing to say until its first fetch
+    if (quote.status == quote_status::NONE)
+        return;
+
+    static const char prefix[] { "{\"symbol\":\"" };
+    m_buffer.insert(std::end(m_buffer), prefix, prefix + sizeof(prefix) - 1);
+
+    for (auto ch : quotes.symbol[id]) {
+        if (ch == '"' || ch == '\\')
+            m_buffer.push_back('\\');
+        m_buffer.push_back(ch);
+    }
+
+    // values come out exactly as the server sent them, less any trailing zeros
+
+    char last[decimal::TEXT_SIZE], change[decimal::TEXT_SIZE], percent_change[decimal::TEXT_SIZE];
+    format_decimal(last, quote.last);
+    format_decimal(change, quote.change);
+    format_decimal(percent_change, quote.percent_change);
+
+    char fields[160];
+    const int length { snprintf(fields, sizeof(fields),
+                                "\",\"time\":%lld,\"status\":\"%s\",\"last\":%s,\"change\":%s,\"percent_change\":%s}\n",
+                                static_cast<long long>(quote.last_update),
+                                quote.status == quote_status::FETCHED ? "ok" : "error",
+                                last, change, percent_change) };
+
+    m_buffer.insert(std::end(m_buffer), fields, fields + std::min<int>(length, sizeof(fields) - 1));
+
+    if (const auto stats = m_engine.stats()) {
+        if (quote.received)
+            stats->record_display(steady_clock_micros() - quote.received);
+    }
+}
+
+bool quote_stream::flush()
+{
+    const char *data { m_buffer.data() };
+    size_t size { m_buffer.size() };
+
+    while (size > 0) {
+        const ssize_t written { write(m_fd, data, size) };
+
+        if (written == -1) {
+            if (errno == EINTR)
+                continue;
+            std::cerr << "failed to write quotes: " << strerror(errno) << "\n";
+            return false;
+        }
+
+        data += written;
+        size -= written;
+    }
+
+    m_buffer.clear();
+    return true;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <boost/core/noncopyable.hpp>
+
+#include "quote_engine.h"
+
+// Headless front end: runs the engine with no display and writes every quote update as one
+// line of JSON to stdout or a file/FIFO. Lines are batched per wakeup into a single write.
+
+class quote_stream : private boost::noncopyable
+{
+public:
+    quote_stream(quote_engine& engine);
+    ~quote_stream();
+
+    // "-" is stdout
+    bool open(const std::string& path);
+
+    bool run();
+
+private:
+    void append(quote_id id);
+    bool flush();
+
+    quote_engine& m_engine;
+    std::vector<quote_id> m_updated;
+    std::vector<char> m_buffer;
+    int m_fd = -1;
+    bool m_owns_fd = false;
+};
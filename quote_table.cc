@@ -0,0 +1,43 @@
+#include "quote_table.h"
+
+quote_table::quote_table()
+    : snapshot { new seqlock<quote_snapshot>[MAX_QUOTES] }
+{
+}
+
+bool quote_table::add(const std::string& symbol_name, quote_id& id)
+{
+    if (find(symbol_name, id))
+        return true;
+
+    if (symbol.size() == MAX_QUOTES)
+        return false;
+
+    id = static_cast<quote_id>(symbol.size());
+    m_ids.emplace(symbol_name, id);
+
+    symbol.push_back(symbol_name);
+    hidden.push_back(0);
+    removed.push_back(0);
+    pending.push_back(0);
+    overdue.push_back(0);
+    retries.push_back(0);
+    interval.push_back(0);
+    alerted.push_back(0);
+
+    return true;
+}
+
+bool quote_table::find(const std::string& symbol_name, quote_id& id) const
+{
+    auto it = m_ids.find(symbol_name);
+    if (it == std::end(m_ids))
+        return false;
+    id = it->second;
+    return true;
+}
+
+size_t quote_table::size() const
+{
+    return symbol.size();
+}
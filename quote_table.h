@@ -0,0 +1,62 @@
+#pragma once
+
+#include <ctime>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+
+#include "seqlock.h"
+#include "decimal.h"
+#include "quote_format.h"
+
+using quote_id = uint32_t;
+
+enum class quote_status : uint8_t { NONE, FETCHED, ERROR };
+
+// what the fetcher publishes for a quote; read by the UI thread without locking
+
+struct quote_snapshot
+{
+    decimal last;
+    decimal change;
+    decimal percent_change;
+    time_t last_update = static_cast<time_t>(0);
+    quote_status status = quote_status::NONE;
+    bool stale = false; // values are from the on-disk cache, not yet confirmed by a fetch
+    bool not_modified = false; // last fetch was a 304, values are as before
+    int64_t received = 0; // steady clock microseconds when the values arrived, for latency stats
+    quote_text text = {};
+};
+
+// Symbols are interned once into dense ids; everything per quote lives in parallel arrays
+// indexed by id, so the update path never touches a string.
+
+struct quote_table
+{
+    // snapshots are preallocated so that quotes can be added while the fetcher is running
+    static const size_t MAX_QUOTES = 1024;
+
+    quote_table();
+
+    // false if the table is full
+    bool add(const std::string& symbol, quote_id& id);
+    bool find(const std::string& symbol, quote_id& id) const;
+    size_t size() const;
+
+    std::vector<std::string> symbol;
+    std::unique_ptr<seqlock<quote_snapshot>[]> snapshot;
+
+    // only touched by the UI thread
+    std::vector<uint8_t> hidden; // fetched on behalf of other instances, or removed; not shown
+    std::vector<uint8_t> removed; // dropped from the config; kept in case it comes back, not fetched
+    std::vector<uint8_t> pending;
+    std::vector<time_t> overdue; // when a pending fetch should long have answered
+    std::vector<int> retries;
+    std::vector<time_t> interval; // current adaptive refresh interval
+    std::vector<time_t> alerted; // until when the quote flashes for an alert that fired
+
+private:
+    std::unordered_map<std::string, quote_id> m_ids;
+};
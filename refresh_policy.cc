@@ -0,0 +1,103 @@
+#include <unistd.h>
+
+#include <algorithm>
+
+#include "refresh_policy.h"
+
+refresh_policy::refresh_policy()
+    : m_random { static_cast<std::minstd_rand::result_type>(time(nullptr) ^ getpid()) }
+{
+}
+
+void refresh_policy::set_update_interval(time_t update_interval)
+{
+    m_update_interval = std::max<time_t>(update_interval, 1);
+}
+
+void refresh_policy::set_min_interval(time_t min_interval)
+{
+    m_min_interval = std::max<time_t>(min_interval, 1);
+}
+
+void refresh_policy::set_closed_interval(time_t closed_interval)
+{
+    m_closed_interval = std::max<time_t>(closed_interval, 1);
+}
+
+void refresh_policy::set_retry_interval(time_t retry_interval)
+{
+    m_retry_interval = std::max<time_t>(retry_interval, 1);
+}
+
+void refresh_policy::set_max_backoff(time_t max_backoff)
+{
+    m_max_backoff = std::max<time_t>(max_backoff, 1);
+}
+
+void refresh_policy::set_spread_updates(bool spread_updates)
+{
+    m_spread_updates = spread_updates;
+}
+
+void refresh_policy::set_market(const market_calendar& market)
+{
+    m_market = market;
+}
+
+time_t refresh_policy::update_interval() const
+{
+    return m_update_interval;
+}
+
+time_t refresh_policy::spread(quote_id id, size_t num_quotes, time_t due, time_t after) const
+{
+    // pull the refresh back onto this quote's own slot in the interval, so that
+    // refreshes end up evenly spread out instead of all coming due at once
+
+    if (!m_spread_updates || num_quotes == 0)
+        return due;
+
+    const time_t phase = id*m_update_interval/num_quotes;
+    const time_t slot = due - (due - phase)%m_update_interval;
+
+    return slot > after ? slot : slot + m_update_interval;
+}
+
+time_t refresh_policy::next_update(quote_id id, size_t num_quotes, time_t last_update, bool moved, time_t& interval) const
+{
+    if (!m_market.is_open(last_update)) {
+        interval = m_update_interval;
+
+        const time_t open { m_market.next_open(last_update) };
+        const time_t closed_update { last_update + m_closed_interval };
+
+        if (closed_update < open)
+            return closed_update;
+
+        // everyone wakes up at the open, spread over the first interval
+        return spread(id, num_quotes, open + m_update_interval, open - 1);
+    }
+
+    if (interval <= 0)
+        interval = m_update_interval;
+
+    interval = moved ? std::max(std::min(m_min_interval, m_update_interval), interval/2) : std::min(m_update_interval, interval*2);
+
+    if (interval < m_update_interval)
+        return last_update + interval;
+
+    return spread(id, num_quotes, last_update + m_update_interval, last_update);
+}
+
+time_t refresh_policy::next_retry(time_t last_update, int failures)
+{
+    // exponential backoff, jittered down to half so that failing symbols don't retry in lockstep
+
+    time_t backoff { m_retry_interval };
+    for (int i = 1; i < failures && backoff < m_max_backoff; ++i)
+        backoff *= 2;
+    backoff = std::min(backoff, m_max_backoff);
+
+    std::uniform_int_distribution<time_t> jitter { (backoff + 1)/2, backoff };
+    return last_update + std::max<time_t>(jitter(m_random), 1);
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <ctime>
+#include <random>
+
+#include "market_calendar.h"
+#include "quote_table.h"
+
+// Decides when a quote is next due. While the market is open, symbols whose price moved are
+// polled faster, down to min_interval, and drift back to the base interval when it stops
+// moving. Outside trading hours everything drops to closed_interval, but wakes up at the
+// open. Failures back off exponentially with jitter and keep retrying at max_backoff.
+
+class refresh_policy
+{
+public:
+    refresh_policy();
+
+    void set_update_interval(time_t update_interval);
+    void set_min_interval(time_t min_interval);
+    void set_closed_interval(time_t closed_interval);
+    void set_retry_interval(time_t retry_interval);
+    void set_max_backoff(time_t max_backoff);
+    void set_spread_updates(bool spread_updates);
+    void set_market(const market_calendar& market);
+
+    time_t update_interval() const;
+
+    // interval is the quote's current adaptive interval, updated in place
+    time_t next_update(quote_id id, size_t num_quotes, time_t last_update, bool moved, time_t& interval) const;
+    time_t next_retry(time_t last_update, int failures);
+
+private:
+    time_t spread(quote_id id, size_t num_quotes, time_t due, time_t after) const;
+
+    time_t m_update_interval = 30;
+    time_t m_min_interval = 10;
+    time_t m_closed_interval = 1800;
+    time_t m_retry_interval = 5;
+    time_t m_max_backoff = 600;
+    bool m_spread_updates = true;
+    market_calendar m_market;
+    std::minstd_rand m_random;
+};
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+// Single-writer sequence lock. The writer never blocks; readers retry only if they raced
+// with a store. The value is kept in relaxed atomic words so that a torn read is never a
+// data race, just a retry.
+
+template <typename T>
+class seqlock
+{
+public:
+    seqlock()
+    {
+        store(T {});
+    }
+
+    seqlock(const seqlock&) = delete;
+    seqlock& operator=(const seqlock&) = delete;
+
+    void store(const T& value)
+    {
+        uint64_t words[WORDS] {};
+        memcpy(words, &value, sizeof(T));
+
+        const uint32_t sequence { m_sequence.load(std::memory_order_relaxed) };
+        m_sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        for (size_t i = 0; i < WORDS; ++i)
+            m_words[i].store(words[i], std::memory_order_relaxed);
+
+        m_sequence.store(sequence + 2, std::memory_order_release);
+    }
+
+    T load() const
+    {
+        T value;
+        while (!try_load(value))
+            ;
+        return value;
+    }
+
+    // gives up after a bounded number of retries, for a writer that may have died
+    // mid-store (in shared memory)
+    bool try_load(T& value, int attempts = 1000) const
+    {
+        uint64_t words[WORDS];
+        uint32_t before, after;
+
+        do {
+            if (attempts-- == 0)
+                return false;
+
+            before = m_sequence.load(std::memory_order_acquire);
+
+            for (size_t i = 0; i < WORDS; ++i)
+                words[i] = m_words[i].load(std::memory_order_relaxed);
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            after = m_sequence.load(std::memory_order_relaxed);
+        } while ((before & 1) || before != after);
+
+        memcpy(&value, words, sizeof(T));
+        return true;
+    }
+
+    // taking over from a writer that died mid-store: close the store it left open
+    void recover()
+    {
+        const uint32_t sequence { m_sequence.load(std::memory_order_relaxed) };
+        if (sequence & 1)
+            m_sequence.store(sequence + 1, std::memory_order_release);
+    }
+
+private:
+    static_assert(std::is_trivially_copyable<T>::value, "seqlock value must be trivially copyable");
+
+    static const size_t WORDS { (sizeof(T) + sizeof(uint64_t) - 1)/sizeof(uint64_t) };
+
+    std::atomic<uint32_t> m_sequence { 0 };
+    std::atomic<uint64_t> m_words[WORDS];
+};
@@ -0,0 +1,54 @@
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include "allocation_count.h"
+
+namespace {
+std::atomic<uint64_t> allocations { 0 };
+}
+
+uint64_t allocation_count()
+{
+    return allocations.load(std::memory_order_relaxed);
+}
+
+void *operator new(std::size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+
+    for (;;) {
+        if (void *p = std::malloc(size ? size : 1))
+            return p;
+
+        const auto handler = std::get_new_handler();
+        if (!handler)
+            throw std::bad_alloc {};
+        handler();
+    }
+}
+
+void *operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
@@ -0,0 +1,7 @@
+#pragma once
+
+#include <cstdint>
+
+// Number of global operator new calls so far, across all threads. Linking this in replaces
+// the global operator new and delete, so it's only built into the allocation test.
+uint64_t allocation_count();
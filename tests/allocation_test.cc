@@ -0,0 +1,132 @@
+#include <sys/wait.h>
+#include <signal.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "allocation_count.h"
+#include "engine_runner.h"
+#include "http_stub.h"
+#include "image_target.h"
+#include "quote_renderer.h"
+
+namespace {
+
+const int QUOTES { 8 };
+
+// The stub allocates for every request it answers, so it runs in a child process where it
+// doesn't show up in the count. Each answer moves the price, so that the refresh interval
+// stays at its minimum.
+class forked_stub
+{
+public:
+    forked_stub()
+    {
+        int fds[2];
+        if (pipe(fds) == -1)
+            return;
+
+        m_pid = fork();
+        if (m_pid == 0) {
+            close(fds[0]);
+            serve(fds[1]);
+        }
+
+        close(fds[1]);
+        if (m_pid == -1 || read(fds[0], &m_port, sizeof(m_port)) != sizeof(m_port))
+            m_port = 0;
+        close(fds[0]);
+    }
+
+    ~forked_stub()
+    {
+        if (m_pid > 0) {
+            kill(m_pid, SIGKILL);
+            waitpid(m_pid, nullptr, 0);
+        }
+    }
+
+    std::string url() const
+    {
+        return "http://127.0.0.1:" + std::to_string(m_port) + "/";
+    }
+
+    bool started() const
+    {
+        return m_port != 0;
+    }
+
+private:
+    [[noreturn]] static void serve(int fd)
+    {
+        int requests { 0 };
+        http_stub stub { [&](const std::string&) {
+            const int cents { ++requests%100 };
+            char body[96];
+            snprintf(body, sizeof(body), "{\"trdprc_1\":\"10.%02d\",\"netchng_1\":\"0.%02d\",\"pctchng\":\"0.%02d\"}", cents, cents, cents);
+            return stub_response { 200, body };
+        } };
+
+        int port { stub.start() ? stub.port() : 0 };
+        write(fd, &port, sizeof(port));
+        close(fd);
+
+        for (;;)
+            pause();
+    }
+
+    pid_t m_pid = -1;
+    int m_port = 0;
+};
+
+}
+
+TEST(allocations, refresh_cycle_does_not_allocate)
+{
+    // after a few cycles to warm up, polling, parsing, publishing, scheduling and drawing
+    // every quote again must run entirely out of what's already allocated
+
+    forked_stub stub;
+    ASSERT_TRUE(stub.started());
+
+    std::vector<std::string> symbols;
+    for (int i = 0; i < QUOTES; ++i)
+        symbols.push_back("SYM" + std::to_string(i));
+
+    quote_engine engine;
+    ASSERT_TRUE(engine.initialize());
+    engine.add_provider(std::unique_ptr<quote_provider> { new json_quote_provider { "stub", stub.url(), quote_fields {} } });
+    engine.configure(test_config(symbols, 1));
+    engine.start();
+
+    const quote_renderer renderer { engine.quotes(), engine.history() };
+    image_target image;
+    size_t frames { 0 };
+
+    engine_runner runner { engine };
+    const auto cycle = [&](std::chrono::milliseconds duration) {
+        const auto deadline = std::chrono::steady_clock::now() + duration;
+        while (std::chrono::steady_clock::now() < deadline && runner.step(deadline)) {
+            for (auto id : runner.updated) {
+                renderer.compose(image, id, engine.quotes().snapshot[id].load(), font_color::NONE);
+                ++frames;
+            }
+        }
+    };
+
+    cycle(std::chrono::milliseconds { 3500 });
+    ASSERT_GE(frames, 2u*QUOTES);
+
+    frames = 0;
+    const uint64_t before { allocation_count() };
+    cycle(std::chrono::milliseconds { 3500 });
+    const uint64_t allocations { allocation_count() - before };
+
+    EXPECT_GE(frames, 2u*QUOTES);
+    EXPECT_EQ(allocations, 0u);
+}
@@ -0,0 +1,329 @@
+// Microbenchmarks for the quote pipeline and an end-to-end throughput run against a local
+// HTTP stub. Results are machine-readable with --benchmark_format=json, or
+// --benchmark_out=FILE --benchmark_out_format=json to keep the console output.
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <curl/curl.h>
+
+#include <boost/lexical_cast.hpp>
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/json_parser.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include "quote_parser.h"
+#include "quote_format.h"
+#include "quote_table.h"
+#include "quote_history.h"
+#include "quote_alerts.h"
+#include "quote_renderer.h"
+#include "image_target.h"
+#include "quote_engine.h"
+#include "quote_fetcher.h"
+#include "http_stub.h"
+
+namespace {
+
+const char quote_body[] { "{\"trdprc_1\":\"27.350\",\"netchng_1\":\"-0.420\",\"pctchng\":\"-1.51\"}" };
+
+std::string padded_body()
+{
+    // a response with the fields buried among others, as some providers send
+    std::string body { "{" };
+    for (int i = 0; i < 40; ++i)
+        body += "\"field_" + std::to_string(i) + "\":{\"a\":[1,2,3],\"b\":\"text\"},";
+    body += "\"trdprc_1\":27.35,\"netchng_1\":-0.42,\"pctchng\":-1.51}";
+    return body;
+}
+
+std::string symbol_name(int i)
+{
+    return "SYM" + std::to_string(i);
+}
+
+void BM_parse_quote(benchmark::State& state)
+{
+    quote_values values;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(parse_quote(quote_body, sizeof(quote_body) - 1, values));
+        benchmark::DoNotOptimize(values);
+    }
+    state.SetBytesProcessed(state.iterations()*(sizeof(quote_body) - 1));
+}
+BENCHMARK(BM_parse_quote);
+
+void BM_parse_quote_padded(benchmark::State& state)
+{
+    const std::string body { padded_body() };
+    quote_values values;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(parse_quote(body.data(), body.size(), values));
+        benchmark::DoNotOptimize(values);
+    }
+    state.SetBytesProcessed(state.iterations()*body.size());
+}
+BENCHMARK(BM_parse_quote_padded);
+
+// what the parser replaced: a full tree out of a stringstream copy, then lexical_cast
+void parse_with_ptree(benchmark::State& state, const std::string& body)
+{
+    for (auto _ : state) {
+        std::stringstream stream;
+        stream << body;
+        boost::property_tree::ptree tree;
+        boost::property_tree::read_json(stream, tree);
+        double values[] {
+            boost::lexical_cast<double>(tree.get<std::string>("trdprc_1")),
+            boost::lexical_cast<double>(tree.get<std::string>("netchng_1")),
+            boost::lexical_cast<double>(tree.get<std::string>("pctchng")),
+        };
+        benchmark::DoNotOptimize(values);
+    }
+    state.SetBytesProcessed(state.iterations()*body.size());
+}
+
+void BM_parse_quote_ptree(benchmark::State& state)
+{
+    parse_with_ptree(state, quote_body);
+}
+BENCHMARK(BM_parse_quote_ptree);
+
+void BM_parse_quote_ptree_padded(benchmark::State& state)
+{
+    parse_with_ptree(state, padded_body());
+}
+BENCHMARK(BM_parse_quote_ptree_padded);
+
+void BM_format_quote(benchmark::State& state)
+{
+    // both branches: two decimals, and integers with thousands separators
+    const decimal lasts[] { decimal::from_units(27350000), decimal::from_units(128456780000) };
+    quote_text text;
+    size_t i { 0 };
+    for (auto _ : state) {
+        format_quote(lasts[i++%2], decimal::from_units(-420000), decimal::from_units(-1510000), text);
+        benchmark::DoNotOptimize(text);
+    }
+}
+BENCHMARK(BM_format_quote);
+
+void BM_symbol_lookup(benchmark::State& state)
+{
+    const int count { static_cast<int>(state.range(0)) };
+
+    quote_table table;
+    std::vector<std::string> symbols;
+    for (int i = 0; i < count; ++i) {
+        quote_id id;
+        symbols.push_back(symbol_name(i));
+        table.add(symbols.back(), id);
+    }
+
+    size_t i { 0 };
+    quote_id id;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(table.find(symbols[i++%count], id));
+        benchmark::DoNotOptimize(id);
+    }
+}
+BENCHMARK(BM_symbol_lookup)->Arg(16)->Arg(1024);
+
+void BM_set_quote_state(benchmark::State& state)
+{
+    quote_engine engine;
+    engine.initialize();
+
+    config conf;
+    for (int i = 0; i < 64; ++i)
+        conf.symbols.push_back(symbol_name(i));
+    conf.market.set_always_open(true);
+    engine.configure(conf);
+
+    // every update queues its id for the front end, which drains them as the loop would
+
+    quote_sink& sink = engine;
+    std::vector<quote_id> updated;
+    quote_id id { 0 };
+    int64_t units { 27350000 };
+    size_t queued { 0 };
+    for (auto _ : state) {
+        sink.set_quote_state(id, decimal::from_units(units), decimal::from_units(-420000), decimal::from_units(-1510000));
+        id = (id + 1)%64;
+        units += 10000;
+
+        if (++queued == 1024) {
+            state.PauseTiming();
+            engine.wait_for_events(-1);
+            updated.clear();
+            engine.reschedule_completed(updated);
+            queued = 0;
+            state.ResumeTiming();
+        }
+    }
+}
+BENCHMARK(BM_set_quote_state);
+
+void BM_compose_frame(benchmark::State& state)
+{
+    quote_table table;
+    quote_history history;
+    history.set_capacity(64);
+
+    quote_id id;
+    table.add("PETR4", id);
+    history.add_quote();
+    for (int i = 0; i < 64; ++i)
+        history.push(id, i, decimal::from_units(27000000 + (i*7919)%500000));
+
+    quote_snapshot quote;
+    quote.last = decimal::from_units(27350000);
+    quote.change = decimal::from_units(-420000);
+    quote.percent_change = decimal::from_units(-1510000);
+    quote.status = quote_status::FETCHED;
+    format_quote(quote.last, quote.change, quote.percent_change, quote.text);
+
+    const quote_renderer renderer { table, history };
+    image_target target;
+    for (auto _ : state) {
+        renderer.compose(target, id, quote, font_color::NONE);
+        benchmark::DoNotOptimize(target.pixels());
+        benchmark::ClobberMemory();
+    }
+}
+BENCHMARK(BM_compose_frame);
+
+void BM_alert_update(benchmark::State& state)
+{
+    // range(0) rules per quote, spread over every kind, with levels across the band the
+    // prices wander in so that some of them keep firing
+    const int QUOTES { 64 };
+    const int rules { static_cast<int>(state.range(0)) };
+
+    quote_table table;
+    for (int i = 0; i < QUOTES; ++i) {
+        quote_id id;
+        table.add(symbol_name(i), id);
+    }
+
+    std::vector<alert_config> configs;
+    for (int i = 0; i < QUOTES; ++i) {
+        for (int r = 0; r < rules; ++r) {
+            const alert_kind kind { static_cast<alert_kind>(r%4) };
+            const int64_t offset { (r*2000000/rules)%2000000 };
+            const int64_t level { kind == alert_kind::ABOVE || kind == alert_kind::BELOW ? 26000000 + offset : offset + 1 };
+            configs.push_back({ symbol_name(i), kind, decimal::from_units(level), std::string {} });
+        }
+    }
+
+    market_calendar market;
+    market.set_always_open(true);
+
+    quote_alerts alerts;
+    alerts.set_market(market);
+    alerts.set_rules(configs, table);
+
+    std::vector<quote_alerts::fired> fired;
+    fired.reserve(QUOTES*rules);
+    size_t fired_count { 0 };
+    quote_id id { 0 };
+    uint64_t step { 0 };
+    for (auto _ : state) {
+        const int64_t units { 26000000 + static_cast<int64_t>((step++*7919)%2000000) };
+        alerts.update(id, 1000000000, decimal::from_units(units), decimal::from_units(units - 27000000), fired);
+        id = (id + 1)%QUOTES;
+
+        fired_count += fired.size();
+        fired.clear();
+    }
+
+    state.counters["fired"] = benchmark::Counter(fired_count, benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_alert_update)->Arg(1)->Arg(16)->Arg(256);
+
+// counts answers so the benchmark can wait for a whole round of fetches
+
+class counting_sink : public quote_sink
+{
+public:
+    void set_quote_state(quote_id, decimal, decimal, decimal) override { answer(false); }
+    void set_quote_unchanged(quote_id) override { answer(false); }
+    void set_quote_error(quote_id) override { answer(true); }
+    void set_replay_time(time_t) override {}
+    void set_replay_done() override {}
+
+    void wait_for(size_t answers)
+    {
+        std::unique_lock<std::mutex> lock { m_mutex };
+        m_condition.wait(lock, [&] { return m_answers >= answers; });
+        m_answers -= answers;
+    }
+
+    size_t errors() const { return m_errors; }
+
+private:
+    void answer(bool error)
+    {
+        std::unique_lock<std::mutex> lock { m_mutex };
+        ++m_answers;
+        if (error)
+            ++m_errors;
+        m_condition.notify_one();
+    }
+
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    size_t m_answers = 0;
+    std::atomic<size_t> m_errors { 0 };
+};
+
+void BM_refresh_throughput(benchmark::State& state)
+{
+    // one round refreshes every symbol through the fetcher, curl and the parser
+
+    const int count { static_cast<int>(state.range(0)) };
+
+    http_stub stub { [](const std::string&) { return stub_response { 200, quote_body }; } };
+    if (!stub.start()) {
+        state.SkipWithError("failed to start the stub");
+        return;
+    }
+
+    counting_sink sink;
+    quote_fetcher fetcher { sink };
+    fetcher.add_provider(std::unique_ptr<quote_provider> { new json_quote_provider { "stub", stub.url(), quote_fields {} } });
+    fetcher.set_max_requests(static_cast<int>(state.range(1)));
+    for (int i = 0; i < count; ++i)
+        fetcher.add_quote(i, symbol_name(i));
+
+    for (auto _ : state) {
+        for (int i = 0; i < count; ++i)
+            fetcher.fetch(i, std::chrono::seconds { 10 });
+        sink.wait_for(count);
+    }
+
+    state.SetItemsProcessed(state.iterations()*count); // symbols refreshed per second
+    state.counters["errors"] = sink.errors();
+}
+BENCHMARK(BM_refresh_throughput)->Args({ 16, 8 })->Args({ 256, 8 })->Args({ 256, 32 })->UseRealTime();
+
+}
+
+int main(int argc, char *argv[])
+{
+    curl_global_init(CURL_GLOBAL_ALL);
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv))
+        return 1;
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+
+    curl_global_cleanup();
+    return 0;
+}
@@ -0,0 +1,178 @@
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "engine_runner.h"
+#include "http_stub.h"
+#include "quote_bus.h"
+
+namespace {
+
+// the segment as another process sees it, to scribble over
+struct raw_segment
+{
+    explicit raw_segment(const std::string& name)
+        : path { name + "-" + std::to_string(geteuid()) }
+    {
+    }
+
+    ~raw_segment()
+    {
+        if (data)
+            munmap(data, size);
+        shm_unlink(path.c_str());
+    }
+
+    bool map()
+    {
+        const int fd { shm_open(path.c_str(), O_RDWR, 0) };
+        if (fd == -1)
+            return false;
+        struct stat st;
+        fstat(fd, &st);
+        size = st.st_size;
+        data = static_cast<char *>(mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0));
+        close(fd);
+        return data != MAP_FAILED;
+    }
+
+    // the header starts with generation, size and layout, then the slots
+    uint32_t *words() { return reinterpret_cast<uint32_t *>(data); }
+
+    const std::string path;
+    char *data = nullptr;
+    size_t size = 0;
+};
+
+std::string test_bus_name(const char *test)
+{
+    return "/wmibov-test-" + std::string { test } + "-" + std::to_string(getpid());
+}
+
+}
+
+TEST(bus, segment_is_private)
+{
+    const std::string name { test_bus_name("private") };
+    raw_segment raw { name };
+
+    quote_bus bus;
+    ASSERT_TRUE(bus.open(name));
+
+    struct stat st;
+    const int fd { shm_open(raw.path.c_str(), O_RDONLY, 0) };
+    ASSERT_NE(fd, -1);
+    fstat(fd, &st);
+    close(fd);
+    EXPECT_EQ(st.st_mode & 0777, 0600u);
+    EXPECT_EQ(st.st_uid, geteuid());
+}
+
+TEST(bus, refuses_a_segment_others_can_write)
+{
+    const std::string name { test_bus_name("shared") };
+    raw_segment raw { name };
+
+    const int fd { shm_open(raw.path.c_str(), O_RDWR | O_CREAT, 0600) };
+    ASSERT_NE(fd, -1);
+    fchmod(fd, 0666);
+    close(fd);
+
+    quote_bus bus;
+    EXPECT_FALSE(bus.open(name));
+}
+
+TEST(bus, survives_a_corrupt_size)
+{
+    const std::string name { test_bus_name("size") };
+    raw_segment raw { name };
+
+    quote_bus bus;
+    ASSERT_TRUE(bus.open(name));
+    ASSERT_EQ(bus.subscribe("PETR4"), 0);
+    ASSERT_TRUE(raw.map());
+
+    raw.words()[1] = 1000000;
+
+    const uint32_t capacity { quote_bus::CAPACITY };
+    EXPECT_EQ(bus.size(), capacity);
+    EXPECT_TRUE(bus.try_lead());
+    EXPECT_EQ(bus.subscribe("PETR4"), 0);
+    EXPECT_EQ(bus.subscribe("VALE3"), -1); // full, as far as anyone can tell
+
+    std::string symbol;
+    for (uint32_t i = 1; i < bus.size(); ++i)
+        EXPECT_FALSE(bus.symbol(i, symbol));
+}
+
+TEST(bus, skips_garbage_slots)
+{
+    const std::string name { test_bus_name("slots") };
+    raw_segment raw { name };
+
+    quote_bus bus;
+    ASSERT_TRUE(bus.open(name));
+    ASSERT_EQ(bus.subscribe("PETR4"), 0);
+    ASSERT_EQ(bus.subscribe("VALE3"), 1);
+    ASSERT_TRUE(bus.try_lead());
+
+    quote_bus::quote q {};
+    q.status = quote_status::FETCHED;
+    bus.publish(0, q);
+    bus.publish(1, q);
+
+    std::string symbol;
+    ASSERT_TRUE(bus.symbol(0, symbol));
+    EXPECT_EQ(symbol, "PETR4");
+    EXPECT_TRUE(bus.read(0, q));
+
+    // an unterminated symbol, and a status no build writes
+    ASSERT_TRUE(raw.map());
+    char *first_slot { raw.data + 16 }; // after the three words, aligned for the seqlock
+    memset(first_slot, 'A', 16);
+    EXPECT_FALSE(bus.symbol(0, symbol));
+
+    q.status = static_cast<quote_status>(7);
+    bus.publish(1, q);
+    EXPECT_FALSE(bus.read(1, q));
+
+    // a layout from another build
+    raw.words()[2] = 99;
+    EXPECT_EQ(bus.size(), 0u);
+}
+
+TEST(bus, engine_adopts_only_valid_symbols)
+{
+    const std::string name { test_bus_name("engine") };
+    raw_segment raw { name };
+
+    quote_bus other;
+    ASSERT_TRUE(other.open(name));
+    ASSERT_EQ(other.subscribe("VALE3"), 0);
+    ASSERT_TRUE(raw.map());
+    raw.words()[1] = 1000000;
+
+    http_stub stub { [](const std::string&) { return stub_response { 200, "{\"trdprc_1\":\"1.00\"}" }; } };
+    ASSERT_TRUE(stub.start());
+
+    quote_engine engine;
+    ASSERT_TRUE(engine.initialize());
+    engine.add_provider(std::unique_ptr<quote_provider> { new json_quote_provider { "stub", stub.url(), quote_fields {} } });
+    ASSERT_TRUE(engine.enable_bus(name));
+    engine.configure(test_config({ "PETR4" }, 30));
+
+    engine_runner runner { engine };
+    engine.start();
+    runner.step(std::chrono::steady_clock::now());
+
+    // the other instance's symbol, and none of the empty slots past it
+    quote_id id;
+    EXPECT_TRUE(engine.quotes().find("VALE3", id));
+    EXPECT_EQ(engine.quotes().size(), 2u);
+}
@@ -0,0 +1,41 @@
+#include <unistd.h>
+
+#include <fstream>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "config.h"
+
+namespace {
+
+// a config file holding text, removed when done
+struct test_config_file
+{
+    test_config_file(const char *test, const std::string& text)
+        : path { "/tmp/wmibov-test-" + std::string { test } + "-" + std::to_string(getpid()) + ".json" }
+    {
+        std::ofstream { path } << text;
+    }
+    ~test_config_file() { unlink(path.c_str()); }
+
+    std::string path;
+};
+
+}
+
+TEST(config, rejects_a_timeout_that_is_not_positive)
+{
+    for (const char *timeout : { "0", "-5" }) {
+        test_config_file file { "timeout", std::string { "{\"timeout\":" } + timeout + "}" };
+
+        config conf;
+        ASSERT_TRUE(load_config(file.path, conf));
+        EXPECT_EQ(conf.timeout, 30) << timeout;
+    }
+
+    test_config_file file { "timeout", "{\"timeout\":7}" };
+    config conf;
+    ASSERT_TRUE(load_config(file.path, conf));
+    EXPECT_EQ(conf.timeout, 7);
+}
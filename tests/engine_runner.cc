@@ -0,0 +1,83 @@
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include "engine_runner.h"
+
+engine_runner::engine_runner(quote_engine& engine)
+    : m_engine { engine }
+    , m_deadline_fd { timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC) }
+{
+}
+
+engine_runner::~engine_runner()
+{
+    close(m_deadline_fd);
+}
+
+bool engine_runner::step(std::chrono::steady_clock::time_point limit)
+{
+    updated.clear();
+    m_engine.reschedule_completed(updated);
+    m_engine.schedule_updates();
+
+    if (m_engine.stopped())
+        return false;
+
+    for (auto id : updated) {
+        if (!m_engine.quotes().hidden[id]) {
+            ++redraws;
+            break;
+        }
+    }
+
+    const auto remaining = std::chrono::duration_cast<std::chrono::nanoseconds>(limit - std::chrono::steady_clock::now()).count();
+    if (remaining <= 0)
+        return true;
+
+    itimerspec timer {};
+    timer.it_value.tv_sec = remaining/1000000000;
+    timer.it_value.tv_nsec = remaining%1000000000;
+    timerfd_settime(m_deadline_fd, 0, &timer, nullptr);
+
+    if (m_engine.wait_for_events(m_deadline_fd)) {
+        uint64_t expirations;
+        read(m_deadline_fd, &expirations, sizeof(expirations));
+    } else {
+        ++wakeups;
+    }
+
+    return true;
+}
+
+bool engine_runner::run_until(const std::function<bool()>& done, std::chrono::milliseconds limit)
+{
+    const auto deadline = std::chrono::steady_clock::now() + limit;
+
+    while (!done()) {
+        if (std::chrono::steady_clock::now() >= deadline || !step(deadline))
+            return done();
+    }
+
+    return true;
+}
+
+void engine_runner::run_for(std::chrono::milliseconds duration)
+{
+    const auto deadline = std::chrono::steady_clock::now() + duration;
+
+    while (std::chrono::steady_clock::now() < deadline && step(deadline))
+        ;
+}
+
+config test_config(const std::vector<std::string>& symbols, int interval)
+{
+    config conf;
+    conf.symbols = symbols;
+    conf.update_interval = interval;
+    conf.min_interval = interval;
+    conf.spread_updates = false;
+    conf.market.set_always_open(true);
+    conf.connect_timeout = 2;
+    conf.timeout = 5;
+    return conf;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <vector>
+
+#include <boost/core/noncopyable.hpp>
+
+#include "quote_engine.h"
+
+// Drives a quote_engine the way a front end does, counting how often the loop wakes up and
+// how often it would have had something to redraw.
+
+class engine_runner : private boost::noncopyable
+{
+public:
+    explicit engine_runner(quote_engine& engine);
+    ~engine_runner();
+
+    // one pass of the loop, waiting at most until the limit; false if the engine stopped
+    bool step(std::chrono::steady_clock::time_point limit);
+
+    // false if the time ran out first
+    bool run_until(const std::function<bool()>& done, std::chrono::milliseconds limit);
+    void run_for(std::chrono::milliseconds duration);
+
+    // wakeups of our own deadline timer aren't counted
+    size_t wakeups = 0;
+    size_t redraws = 0;
+    std::vector<quote_id> updated; // from the last pass
+
+private:
+    quote_engine& m_engine;
+    int m_deadline_fd = -1;
+};
+
+// a config for the quotes, polling every interval seconds with the market always open
+config test_config(const std::vector<std::string>& symbols, int interval);
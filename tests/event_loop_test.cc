@@ -0,0 +1,146 @@
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <memory>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include "engine_runner.h"
+#include "http_stub.h"
+
+namespace {
+
+const char quote_body[] { "{\"trdprc_1\":\"10.00\",\"netchng_1\":\"0.10\",\"pctchng\":\"1.00\"}" };
+
+bool all_fetched(const quote_engine& engine)
+{
+    const auto& quotes = engine.quotes();
+    for (quote_id id = 0; id < quotes.size(); ++id) {
+        if (quotes.snapshot[id].load().status != quote_status::FETCHED)
+            return false;
+    }
+    return quotes.size() > 0;
+}
+
+}
+
+// An idle display should sleep until a fetch is due, and only redraw when a quote comes
+// back. WMIBOV_IDLE_SECONDS=60 runs the full idle minute; the default keeps the suite fast.
+
+TEST(event_loop, idle_wakeups_and_redraws)
+{
+    const char *seconds { getenv("WMIBOV_IDLE_SECONDS") };
+    const int idle { seconds ? atoi(seconds) : 3 };
+    const int interval { 30 };
+
+    http_stub stub { [](const std::string&) { return stub_response { 200, quote_body }; } };
+    ASSERT_TRUE(stub.start());
+
+    quote_engine engine;
+    ASSERT_TRUE(engine.initialize());
+    engine.add_provider(std::unique_ptr<quote_provider> { new json_quote_provider { "stub", stub.url(), quote_fields {} } });
+    engine.configure(test_config({ "A", "B", "C" }, interval));
+
+    engine_runner runner { engine };
+    engine.start();
+    ASSERT_TRUE(runner.run_until([&] { return all_fetched(engine); }, std::chrono::seconds { 5 }));
+
+    // the last answer can be in the snapshot before its completion has been drained
+    runner.step(std::chrono::steady_clock::now());
+    runner.wakeups = runner.redraws = 0;
+    const size_t requests_before { stub.requests() };
+
+    runner.run_for(std::chrono::seconds { idle });
+
+    // each refresh wakes the loop once for the timer and once for the answer, and the
+    // answer is the only thing to redraw; polling every 50 ms would be 20 wakeups a second
+
+    const size_t refreshes { stub.requests() - requests_before };
+
+    EXPECT_LE(refreshes, 3u*(idle/interval + 1));
+    EXPECT_LE(runner.wakeups, 2*refreshes);
+    EXPECT_LE(runner.redraws, refreshes);
+
+    if (idle < interval) {
+        EXPECT_EQ(refreshes, 0u);
+        EXPECT_EQ(runner.wakeups, 0u);
+        EXPECT_EQ(runner.redraws, 0u);
+    }
+}
+
+// A 304 can arrive while the 200 before it is still waiting to be read; the new price must
+// still be recorded and redrawn.
+
+TEST(event_loop, unchanged_after_an_unread_update)
+{
+    quote_engine engine;
+    ASSERT_TRUE(engine.initialize());
+    engine.configure(test_config({ "A" }, 30));
+
+    quote_id id;
+    ASSERT_TRUE(engine.quotes().find("A", id));
+
+    const decimal price { decimal::from_units(10*decimal::SCALE) };
+    quote_sink& sink = engine;
+    sink.set_quote_state(id, price, decimal {}, decimal {});
+    sink.set_quote_unchanged(id);
+
+    std::vector<quote_id> updated;
+    engine.wait_for_events(-1);
+    engine.reschedule_completed(updated);
+
+    EXPECT_EQ(updated, std::vector<quote_id> { id });
+    ASSERT_EQ(engine.history().size(id), 1u);
+    EXPECT_EQ(engine.history().at(id, 0).price, price);
+
+    // once it has been read, a 304 is only a 304
+    sink.set_quote_unchanged(id);
+    updated.clear();
+    engine.wait_for_events(-1);
+    engine.reschedule_completed(updated);
+
+    EXPECT_TRUE(updated.empty());
+    EXPECT_EQ(engine.history().size(id), 1u);
+}
+
+// Alert commands are reaped by pid; a child of whatever embeds the engine keeps its exit
+// status for its own parent.
+
+TEST(event_loop, reaps_only_its_alert_commands)
+{
+    quote_engine engine;
+    ASSERT_TRUE(engine.initialize());
+
+    config conf { test_config({ "A" }, 30) };
+    conf.alerts.push_back({ "A", alert_kind::ABOVE, decimal::from_units(10*decimal::SCALE), "true" });
+    engine.configure(conf);
+
+    quote_id id;
+    ASSERT_TRUE(engine.quotes().find("A", id));
+
+    const pid_t child { fork() };
+    ASSERT_NE(child, -1);
+    if (child == 0)
+        _exit(7);
+
+    // the first price sets the baseline, the second crosses the level
+    quote_sink& sink = engine;
+    sink.set_quote_state(id, decimal::from_units(9*decimal::SCALE), decimal {}, decimal {});
+    sink.set_quote_state(id, decimal::from_units(11*decimal::SCALE), decimal {}, decimal {});
+
+    std::vector<quote_id> updated;
+    engine.wait_for_events(-1);
+    engine.reschedule_completed(updated);
+
+    // give both children time to exit, then let the engine reap
+    std::this_thread::sleep_for(std::chrono::milliseconds { 200 });
+    engine.reschedule_completed(updated);
+
+    int status;
+    ASSERT_EQ(waitpid(child, &status, 0), child);
+    EXPECT_TRUE(WIFEXITED(status));
+    EXPECT_EQ(WEXITSTATUS(status), 7);
+}
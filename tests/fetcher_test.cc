@@ -0,0 +1,238 @@
+#include <chrono>
+#include <condition_variable>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include "engine_runner.h"
+#include "http_stub.h"
+#include "quote_fetcher.h"
+
+namespace {
+
+using steady_clock = std::chrono::steady_clock;
+
+const char *QUOTE_BODY { "{\"trdprc_1\":\"10.00\",\"netchng_1\":\"0.10\",\"pctchng\":\"1.01\"}" };
+
+class recording_sink : public quote_sink
+{
+public:
+    void set_quote_state(quote_id, decimal, decimal, decimal) override { answer(false); }
+    void set_quote_unchanged(quote_id) override { answer(false); }
+    void set_quote_error(quote_id) override { answer(true); }
+    void set_replay_time(time_t) override {}
+    void set_replay_done() override {}
+
+    // false if they didn't all come in time
+    bool wait_for(size_t answers, std::chrono::milliseconds limit)
+    {
+        std::unique_lock<std::mutex> lock { m_mutex };
+        return m_condition.wait_for(lock, limit, [&] { return m_answers >= answers; });
+    }
+
+    size_t answers() { std::unique_lock<std::mutex> lock { m_mutex }; return m_answers; }
+    size_t errors() { std::unique_lock<std::mutex> lock { m_mutex }; return m_errors; }
+
+private:
+    void answer(bool error)
+    {
+        std::unique_lock<std::mutex> lock { m_mutex };
+        ++m_answers;
+        if (error)
+            ++m_errors;
+        m_condition.notify_all();
+    }
+
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    size_t m_answers = 0;
+    size_t m_errors = 0;
+};
+
+// collects what goes to std::cerr while in scope
+class cerr_capture
+{
+public:
+    cerr_capture() : m_saved { std::cerr.rdbuf(m_buffer.rdbuf()) } {}
+    ~cerr_capture() { std::cerr.rdbuf(m_saved); }
+
+    std::string str() const { return m_buffer.str(); }
+
+private:
+    std::ostringstream m_buffer;
+    std::streambuf *m_saved;
+};
+
+std::unique_ptr<quote_provider> stub_provider(const http_stub& stub)
+{
+    return std::unique_ptr<quote_provider> { new json_quote_provider { "stub", stub.url(), quote_fields {} } };
+}
+
+bool wait_for_requests(const http_stub& stub, size_t requests)
+{
+    const auto limit = steady_clock::now() + std::chrono::seconds { 5 };
+    while (stub.requests() < requests) {
+        if (steady_clock::now() > limit)
+            return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds { 5 });
+    }
+    return true;
+}
+
+long elapsed_ms(steady_clock::time_point since)
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(steady_clock::now() - since).count();
+}
+
+}
+
+TEST(fetcher, fails_fetches_that_expire_in_the_queue_without_asking_the_provider)
+{
+    // one slot and a slow server: only the first few fetches get a turn within the budget,
+    // the rest expire waiting and mustn't reach the server or count against it
+
+    const int QUOTES { 30 };
+
+    http_stub stub { [](const std::string&) {
+        stub_response response { 200, QUOTE_BODY };
+        response.delay_ms = 500;
+        return response;
+    } };
+    ASSERT_TRUE(stub.start());
+
+    cerr_capture captured;
+    recording_sink sink;
+    {
+        quote_fetcher fetcher { sink };
+        fetcher.add_provider(stub_provider(stub));
+        fetcher.set_max_requests(1);
+        for (int i = 0; i < QUOTES; ++i)
+            fetcher.add_quote(i, "SYM" + std::to_string(i));
+
+        for (int i = 0; i < QUOTES; ++i)
+            fetcher.fetch(i, std::chrono::milliseconds { 1200 });
+
+        ASSERT_TRUE(sink.wait_for(QUOTES, std::chrono::seconds { 5 }));
+    }
+
+    const size_t answered { QUOTES - sink.errors() };
+    EXPECT_GE(answered, 1u);
+    EXPECT_LE(stub.requests(), answered + 1); // at most the one in flight when the budget ran out
+    EXPECT_EQ(captured.str().find("demoted"), std::string::npos) << captured.str();
+}
+
+TEST(fetcher, fetch_after_a_cancel_is_answered)
+{
+    // a quote dropped and added back, or rescheduled, before the fetcher thread gets to the
+    // cancel; the cancel must only take the fetch it was meant for
+
+    http_stub stub { [](const std::string&) {
+        stub_response response { 200, QUOTE_BODY };
+        response.delay_ms = 300;
+        return response;
+    } };
+    ASSERT_TRUE(stub.start());
+
+    const quote_id id { 0 };
+
+    recording_sink sink;
+    quote_fetcher fetcher { sink };
+    fetcher.add_provider(stub_provider(stub));
+    fetcher.add_quote(id, "SYM");
+
+    fetcher.fetch(id, std::chrono::seconds { 5 });
+    ASSERT_TRUE(wait_for_requests(stub, 1));
+
+    fetcher.cancel(id);
+    fetcher.fetch(id, std::chrono::seconds { 5 });
+
+    ASSERT_TRUE(sink.wait_for(1, std::chrono::seconds { 3 }));
+    EXPECT_EQ(sink.errors(), 0u);
+
+    // and the cancelled one never answers on top of it
+    std::this_thread::sleep_for(std::chrono::milliseconds { 500 });
+    EXPECT_EQ(sink.answers(), 1u);
+}
+
+TEST(fetcher, stalled_fetch_fails_by_its_budget)
+{
+    http_stub stub { [](const std::string&) {
+        stub_response response { 200, QUOTE_BODY };
+        response.stall = true;
+        return response;
+    } };
+    ASSERT_TRUE(stub.start());
+
+    recording_sink sink;
+    quote_fetcher fetcher { sink };
+    fetcher.add_provider(stub_provider(stub));
+    fetcher.add_quote(0, "SYM");
+
+    const auto started = steady_clock::now();
+    fetcher.fetch(0, std::chrono::milliseconds { 300 });
+
+    ASSERT_TRUE(sink.wait_for(1, std::chrono::seconds { 5 }));
+    EXPECT_EQ(sink.errors(), 1u);
+    EXPECT_GE(elapsed_ms(started), 250);
+    EXPECT_LT(elapsed_ms(started), 1500);
+}
+
+TEST(fetcher, shuts_down_while_the_server_hangs)
+{
+    const int QUOTES { 4 };
+
+    http_stub stub { [](const std::string&) {
+        stub_response response { 200, QUOTE_BODY };
+        response.stall = true;
+        return response;
+    } };
+    ASSERT_TRUE(stub.start());
+
+    recording_sink sink;
+    std::unique_ptr<quote_fetcher> fetcher { new quote_fetcher { sink } };
+    fetcher->add_provider(stub_provider(stub));
+    for (int i = 0; i < QUOTES; ++i)
+        fetcher->add_quote(i, "SYM" + std::to_string(i));
+    for (int i = 0; i < QUOTES; ++i)
+        fetcher->fetch(i, std::chrono::seconds { 30 });
+
+    ASSERT_TRUE(wait_for_requests(stub, QUOTES));
+
+    const auto started = steady_clock::now();
+    fetcher.reset();
+    EXPECT_LT(elapsed_ms(started), 1000);
+    EXPECT_EQ(sink.answers(), 0u); // dropped, not failed
+}
+
+TEST(fetcher, engine_shuts_down_while_the_server_hangs)
+{
+    http_stub stub { [](const std::string&) {
+        stub_response response { 200, QUOTE_BODY };
+        response.stall = true;
+        return response;
+    } };
+    ASSERT_TRUE(stub.start());
+
+    std::unique_ptr<quote_engine> engine { new quote_engine };
+    ASSERT_TRUE(engine->initialize());
+    engine->add_provider(stub_provider(stub));
+    engine->configure(test_config({ "AAA", "BBB" }, 30));
+    engine->start();
+
+    {
+        // nothing ever answers, so step in short slices rather than wait out a long limit
+        engine_runner runner { *engine };
+        for (int i = 0; i < 100 && stub.requests() < 2; ++i)
+            runner.step(steady_clock::now() + std::chrono::milliseconds { 50 });
+        ASSERT_GE(stub.requests(), 2u);
+    }
+
+    const auto started = steady_clock::now();
+    engine.reset();
+    EXPECT_LT(elapsed_ms(started), 1000);
+}
@@ -0,0 +1,139 @@
+#include <cmath>
+#include <cstring>
+#include <string>
+
+#include <boost/format.hpp>
+
+#include <gtest/gtest.h>
+
+#include "quote_format.h"
+
+namespace {
+
+decimal parse(const std::string& text)
+{
+    decimal value;
+    EXPECT_TRUE(parse_decimal(text.data(), text.data() + text.size(), value)) << text;
+    return value;
+}
+
+// what draw_quote used to build with boost::format on every redraw
+void reference_format(double last, double change, double percent_change, std::string& last_str, std::string& change_str, std::string& percent_change_str)
+{
+    if (last >= 100) {
+        const auto ilast = std::lround(last);
+        const auto ichange = std::lround(change);
+
+        if (ilast >= 1000)
+            last_str = (boost::format { "%d,%03d" } % (ilast / 1000) % (ilast % 1000)).str();
+        else
+            last_str = (boost::format { "%d" } % ilast).str();
+        change_str = (boost::format { "%+d" } % ichange).str();
+    } else {
+        last_str = (boost::format { "%.2f" } % last).str();
+        change_str = (boost::format { "%+.2f" } % change).str();
+    }
+    percent_change_str = (boost::format { "%+.2f%%" } % percent_change).str();
+}
+
+void expect_same(const std::string& last, const std::string& change, const std::string& percent_change)
+{
+    quote_text text;
+    format_quote(parse(last), parse(change), parse(percent_change), text);
+
+    std::string last_str, change_str, percent_change_str;
+    reference_format(std::stod(last), std::stod(change), std::stod(percent_change), last_str, change_str, percent_change_str);
+
+    EXPECT_STREQ(text.last, last_str.c_str()) << last;
+    EXPECT_STREQ(text.change, change_str.c_str()) << last << " " << change;
+    EXPECT_STREQ(text.percent_change, percent_change_str.c_str()) << percent_change;
+}
+
+// values printf rounds differently since quotes are exact decimals; see rounds_exact_decimals
+bool differs_on_purpose(int64_t units, bool integer)
+{
+    const int64_t step { integer ? decimal::SCALE : decimal::SCALE/100 };
+    const int64_t rest { (units < 0 ? -units : units)%step };
+    return rest == step/2 || (!integer && units < 0 && units > -step/2);
+}
+
+}
+
+TEST(format, matches_boost_format)
+{
+    const char *const rows[][3] {
+        { "27.35", "-0.42", "-1.51" },
+        { "27.35", "0.42", "1.51" },
+        { "0", "0", "0" },
+        { "0.01", "0.01", "0.01" },
+        { "9.999", "-9.999", "-99.999" },
+        { "99.99", "99.99", "100" },
+        { "99.996", "1.234", "12.3456" },
+        { "100", "-1", "-0.99" },
+        { "100.4", "-0.4", "-0.4" },
+        { "100.6", "-0.6", "0.6" },
+        { "999.4", "12.49", "1.01" },
+        { "999.6", "-12.51", "-1.01" },
+        { "1000", "1000", "100" },
+        { "1001.2", "-3.7", "-0.37" },
+        { "12345.678", "123.456", "1.0" },
+        { "128456.78", "-1234.5678", "-0.96" },
+        { "1000000", "0", "0" },
+        { "7.007", "-0.006", "0.004" },
+        { "0.125001", "0.124999", "0.0149" },
+    };
+
+    for (const auto& row : rows)
+        expect_same(row[0], row[1], row[2]);
+}
+
+TEST(format, rounds_exact_decimals)
+{
+    // ties round away from zero on the exact value, where printf rounded the nearest double
+    // (half to even when that's exact), and a value that rounds to zero has no sign of its own
+
+    const struct
+    {
+        const char *value;
+        const char *formatted;
+        const char *printf_formatted;
+    } rows[] {
+        { "0.125", "+0.13", "+0.12" },
+        { "1.005", "+1.01", "+1.00" },
+        { "2.675", "+2.68", "+2.67" },
+        { "-0.004", "+0.00", "-0.00" },
+        { "-0.125", "-0.13", "-0.12" },
+        { "-1.005", "-1.01", "-1.00" },
+        { "0.375", "+0.38", "+0.38" },
+        { "0.004", "+0.00", "+0.00" },
+    };
+
+    for (const auto& row : rows) {
+        quote_text text;
+        format_quote(parse("1"), parse(row.value), parse(row.value), text);
+
+        EXPECT_STREQ(text.change, row.formatted) << row.value;
+        EXPECT_EQ(std::string { text.percent_change }, std::string { row.formatted } + "%") << row.value;
+        EXPECT_EQ((boost::format { "%+.2f" } % std::stod(row.value)).str(), row.printf_formatted) << row.value;
+    }
+}
+
+TEST(format, sweep_matches_boost_format)
+{
+    // a spread of magnitudes and digits through both branches, skipping the exact ties and
+    // tiny negatives where the old double formatting differs on purpose
+
+    for (int64_t units = -2000000000; units <= 2000000000; units += 123457) {
+        const decimal value { decimal::from_units(units) };
+        const decimal last { decimal::from_units(units < 0 ? -units : units) };
+        const bool integer { last.units() >= 100*decimal::SCALE };
+
+        if (differs_on_purpose(units, integer) || differs_on_purpose(units, false) || differs_on_purpose(last.units(), integer))
+            continue;
+
+        char last_text[decimal::TEXT_SIZE], value_text[decimal::TEXT_SIZE];
+        format_decimal(last_text, last);
+        format_decimal(value_text, value);
+        expect_same(last_text, value_text, value_text);
+    }
+}
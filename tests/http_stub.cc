@@ -0,0 +1,284 @@
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+
+#include "http_stub.h"
+
+namespace {
+
+const char *reason(int status)
+{
+    switch (status) {
+    case 200:
+        return "OK";
+    case 304:
+        return "Not Modified";
+    case 404:
+        return "Not Found";
+    case 500:
+        return "Internal Server Error";
+    case 503:
+        return "Service Unavailable";
+    default:
+        return "Status";
+    }
+}
+
+bool write_all(int fd, const char *data, size_t size)
+{
+    while (size > 0) {
+        const ssize_t written { send(fd, data, size, MSG_NOSIGNAL) };
+        if (written <= 0)
+            return false;
+        data += written;
+        size -= written;
+    }
+    return true;
+}
+
+}
+
+http_stub::http_stub(handler h, int port)
+    : m_handler { std::move(h) }
+    , m_port { port }
+{
+}
+
+http_stub::~http_stub()
+{
+    stop();
+}
+
+bool http_stub::start()
+{
+    m_stop_fd = eventfd(0, EFD_CLOEXEC);
+    m_listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (m_stop_fd == -1 || m_listen_fd == -1)
+        return false;
+
+    const int one { 1 };
+    setsockopt(m_listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    sockaddr_in address {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(m_port);
+
+    socklen_t length { sizeof(address) };
+    if (bind(m_listen_fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) == -1 ||
+        listen(m_listen_fd, 128) == -1 ||
+        getsockname(m_listen_fd, reinterpret_cast<sockaddr *>(&address), &length) == -1)
+        return false;
+
+    m_port = ntohs(address.sin_port);
+    m_acceptor = std::thread { [this] { accept_connections(); } };
+    return true;
+}
+
+void http_stub::stop()
+{
+    if (m_stop_fd == -1)
+        return;
+
+    const uint64_t one { 1 };
+    write(m_stop_fd, &one, sizeof(one));
+
+    if (m_acceptor.joinable())
+        m_acceptor.join();
+
+    std::vector<std::thread> connections;
+    {
+        std::unique_lock<std::mutex> lock { m_mutex };
+        connections.swap(m_connections);
+    }
+    for (auto& t : connections)
+        t.join();
+
+    close(m_listen_fd);
+    close(m_stop_fd);
+    m_listen_fd = m_stop_fd = -1;
+}
+
+int http_stub::port() const
+{
+    return m_port;
+}
+
+std::string http_stub::url() const
+{
+    return "http://127.0.0.1:" + std::to_string(m_port) + "/";
+}
+
+size_t http_stub::requests() const
+{
+    return m_requests;
+}
+
+bool http_stub::wait_readable(int fd) const
+{
+    // false once the stub is stopping
+
+    pollfd fds[] {
+        { fd, POLLIN, 0 },
+        { m_stop_fd, POLLIN, 0 },
+    };
+
+    while (poll(fds, 2, -1) == -1) {
+        if (errno != EINTR)
+            return false;
+    }
+
+    return !(fds[1].revents & POLLIN);
+}
+
+bool http_stub::pause(int ms) const
+{
+    // false if the stub started stopping meanwhile
+
+    pollfd fds[] { { m_stop_fd, POLLIN, 0 } };
+
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds { ms };
+    for (;;) {
+        const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+        if (remaining <= 0)
+            return true;
+        if (poll(fds, 1, remaining) > 0)
+            return false;
+    }
+}
+
+void http_stub::accept_connections()
+{
+    while (wait_readable(m_listen_fd)) {
+        const int fd { accept4(m_listen_fd, nullptr, nullptr, SOCK_CLOEXEC) };
+        if (fd == -1)
+            continue;
+
+        const int one { 1 };
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        std::unique_lock<std::mutex> lock { m_mutex };
+        m_connections.emplace_back([this, fd] { serve(fd); });
+    }
+}
+
+bool http_stub::read_request(int fd, std::string& buffer, std::string& path) const
+{
+    // only GETs without a body are expected; buffer keeps whatever follows the headers
+
+    size_t end;
+    while ((end = buffer.find("\r\n\r\n")) == std::string::npos) {
+        if (!wait_readable(fd))
+            return false;
+
+        char data[4096];
+        const ssize_t size { recv(fd, data, sizeof(data), 0) };
+        if (size <= 0)
+            return false;
+        buffer.append(data, size);
+    }
+
+    const size_t method_end { buffer.find(' ') };
+    const size_t path_end { buffer.find(' ', method_end + 1) };
+    if (method_end == std::string::npos || path_end == std::string::npos || path_end > end)
+        return false;
+
+    path = buffer.substr(method_end + 1, path_end - method_end - 1);
+    buffer.erase(0, end + 4);
+    return true;
+}
+
+void http_stub::stream(int fd, const stub_response& response) const
+{
+    class connection_writer : public stub_writer
+    {
+    public:
+        connection_writer(const http_stub& stub, int fd)
+            : m_stub { stub }, m_fd { fd } {}
+
+        bool write(const std::string& data) override
+        {
+            return write_all(m_fd, data.data(), data.size());
+        }
+
+        bool pause(int ms) override
+        {
+            return m_stub.pause(ms);
+        }
+
+    private:
+        const http_stub& m_stub;
+        int m_fd;
+    };
+
+    // no length: the body runs until the connection closes
+    std::string head { "HTTP/1.1 " + std::to_string(response.status) + " " + reason(response.status) + "\r\nConnection: close\r\n" };
+    for (const auto& header : response.headers)
+        head += header + "\r\n";
+    head += "\r\n";
+
+    connection_writer writer { *this, fd };
+    if (writer.write(head))
+        response.stream(writer);
+}
+
+void http_stub::serve(int fd)
+{
+    std::string buffer, path;
+
+    while (read_request(fd, buffer, path)) {
+        ++m_requests;
+
+        const stub_response response { m_handler(path) };
+
+        if (response.delay_ms > 0 && !pause(response.delay_ms))
+            break;
+
+        if (response.reset)
+            break;
+
+        if (response.stall) {
+            // the client closing the connection makes it readable
+            wait_readable(fd);
+            break;
+        }
+
+        if (response.stream) {
+            stream(fd, response);
+            break;
+        }
+
+        std::string head { "HTTP/1.1 " + std::to_string(response.status) + " " + reason(response.status) + "\r\n" };
+        head += "Content-Length: " + std::to_string(response.body.size()) + "\r\n";
+        for (const auto& header : response.headers)
+            head += header + "\r\n";
+        head += "\r\n";
+
+        if (!write_all(fd, head.data(), head.size()))
+            break;
+
+        const size_t size { response.truncate ? response.body.size()/2 : response.body.size() };
+        const size_t chunk { response.drip_bytes > 0 ? static_cast<size_t>(response.drip_bytes) : size };
+
+        bool sent { true };
+        for (size_t offset = 0; sent && offset < size; offset += chunk) {
+            if (offset > 0 && !pause(response.drip_interval_ms))
+                sent = false;
+            else
+                sent = write_all(fd, response.body.data() + offset, std::min(chunk, size - offset));
+        }
+
+        if (!sent || response.truncate)
+            break;
+    }
+
+    close(fd);
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/core/noncopyable.hpp>
+
+// Local HTTP/1.1 server for tests and benchmarks, listening on an ephemeral port on
+// 127.0.0.1 (or a given one). Each request's path goes to a handler that says how to
+// answer, including how to misbehave. Connections are kept alive, each on its own thread,
+// until the client closes them or the stub stops.
+
+// what a streaming response writes with; both are false once the client is gone or the
+// stub is stopping
+class stub_writer
+{
+public:
+    virtual ~stub_writer() = default;
+    virtual bool write(const std::string& data) = 0;
+    virtual bool pause(int ms) = 0;
+};
+
+struct stub_response
+{
+    stub_response() = default;
+    stub_response(int s, std::string b, std::vector<std::string> h = {})
+        : status { s }, body { std::move(b) }, headers { std::move(h) } {}
+
+    int status = 200;
+    std::string body;
+    std::vector<std::string> headers; // "Name: value"
+
+    int delay_ms = 0;       // before answering at all
+    bool reset = false;     // close the connection instead of answering
+    bool stall = false;     // never answer, until the client gives up or the stub stops
+    bool truncate = false;  // promise the whole body, send half of it and close
+    int drip_bytes = 0;     // send the body this many bytes at a time,
+    int drip_interval_ms = 0; // this far apart
+
+    // if set, the body is whatever this writes until it returns, and the connection closes
+    std::function<void(stub_writer&)> stream;
+};
+
+class http_stub : private boost::noncopyable
+{
+public:
+    using handler = std::function<stub_response(const std::string& path)>;
+
+    explicit http_stub(handler h, int port = 0);
+    ~http_stub();
+
+    bool start();
+    void stop();
+
+    int port() const;
+    std::string url() const; // with a trailing slash, for the symbol to be appended
+    size_t requests() const;
+
+private:
+    void accept_connections();
+    void serve(int fd);
+    bool wait_readable(int fd) const;
+    bool pause(int ms) const;
+    void stream(int fd, const stub_response& response) const;
+    bool read_request(int fd, std::string& buffer, std::string& path) const;
+
+    handler m_handler;
+    int m_listen_fd = -1;
+    int m_stop_fd = -1;
+    int m_port = 0;
+    std::atomic<size_t> m_requests { 0 };
+
+    std::thread m_acceptor;
+    std::mutex m_mutex;
+    std::vector<std::thread> m_connections;
+};
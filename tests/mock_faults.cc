@@ -0,0 +1,119 @@
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <sstream>
+
+#include "mock_faults.h"
+
+const char *fault_name(fault f)
+{
+    switch (f) {
+    case fault::NONE:
+        return "none";
+    case fault::LATENCY:
+        return "latency";
+    case fault::DRIP:
+        return "drip";
+    case fault::RESET:
+        return "reset";
+    case fault::STATUS:
+        return "status";
+    case fault::TRUNCATE:
+        return "truncate";
+    case fault::STALL:
+        return "stall";
+    case fault::COUNT:
+        break;
+    }
+    return "unknown";
+}
+
+bool fault_answers(fault f)
+{
+    return f == fault::NONE || f == fault::LATENCY || f == fault::DRIP;
+}
+
+bool fault_rates::parse(const std::string& spec)
+{
+    std::istringstream stream { spec };
+    std::string item;
+
+    while (std::getline(stream, item, ',')) {
+        const size_t equals { item.find('=') };
+        if (equals == std::string::npos)
+            return false;
+
+        const std::string name { item.substr(0, equals) };
+        const double rate { atof(item.c_str() + equals + 1) };
+
+        int index { 1 };
+        while (index < static_cast<int>(fault::COUNT) && name != fault_name(static_cast<fault>(index)))
+            ++index;
+        if (index == static_cast<int>(fault::COUNT) || rate < 0 || rate > 1)
+            return false;
+
+        rates[index] = rate;
+    }
+
+    return true;
+}
+
+fault fault_rates::pick(std::mt19937& random) const
+{
+    double roll { std::uniform_real_distribution<double> { 0, 1 }(random) };
+
+    for (int i = 1; i < static_cast<int>(fault::COUNT); ++i) {
+        if (roll < rates[i])
+            return static_cast<fault>(i);
+        roll -= rates[i];
+    }
+
+    return fault::NONE;
+}
+
+std::string mock_quote_body(const std::string& symbol)
+{
+    // made up but stable per symbol: last between 10 and 110, change within a real either way
+    const size_t hash { std::hash<std::string> {}(symbol) };
+    const int cents { 1000 + static_cast<int>(hash%10000) };
+    const int change { static_cast<int>((hash/10000)%201) - 100 };
+
+    char body[128];
+    snprintf(body, sizeof(body), "{\"trdprc_1\":\"%d.%02d\",\"netchng_1\":\"%s%d.%02d\",\"pctchng\":\"%s0.%02d\"}",
+             cents/100, cents%100, change < 0 ? "-" : "", abs(change)/100, abs(change)%100, change < 0 ? "-" : "", abs(change)%100);
+    return body;
+}
+
+stub_response mock_response(fault f, const std::string& symbol, const fault_rates& rates, std::mt19937& random)
+{
+    stub_response response { 200, mock_quote_body(symbol) };
+
+    switch (f) {
+    case fault::LATENCY:
+        response.delay_ms = rates.latency_ms;
+        break;
+    case fault::DRIP:
+        response.drip_bytes = rates.drip_bytes;
+        response.drip_interval_ms = rates.drip_interval_ms;
+        break;
+    case fault::RESET:
+        response.reset = true;
+        break;
+    case fault::STATUS: {
+        const int codes[] { 404, 500, 503 };
+        response.status = codes[std::uniform_int_distribution<int> { 0, 2 }(random)];
+        response.body = "{\"error\":\"mock\"}";
+        break;
+    }
+    case fault::TRUNCATE:
+        response.truncate = true;
+        break;
+    case fault::STALL:
+        response.stall = true;
+        break;
+    default:
+        break;
+    }
+
+    return response;
+}
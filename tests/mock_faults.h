@@ -0,0 +1,43 @@
+#pragma once
+
+#include <random>
+#include <string>
+
+#include "http_stub.h"
+
+// The ways the mock quote server misbehaves, shared by wmibov_mock_server and the stress
+// harness so that a fetch's outcome can be checked against what was injected.
+
+enum class fault
+{
+    NONE,
+    LATENCY,  // answers, late
+    DRIP,     // answers, a few bytes at a time
+    RESET,    // closes the connection without answering
+    STATUS,   // answers 404, 500 or 503
+    TRUNCATE, // closes halfway through the body
+    STALL,    // never answers
+    COUNT,
+};
+
+const char *fault_name(fault f);
+
+// whether the fetch should still come back with the quote
+bool fault_answers(fault f);
+
+struct fault_rates
+{
+    double rates[static_cast<int>(fault::COUNT)] {}; // NONE takes whatever is left
+    int latency_ms = 200;
+    int drip_bytes = 8;
+    int drip_interval_ms = 20;
+
+    // "latency=0.1,stall=0.01,..."; false if malformed
+    bool parse(const std::string& spec);
+    fault pick(std::mt19937& random) const;
+};
+
+// the quote the mock serves for a symbol, the same on every request
+std::string mock_quote_body(const std::string& symbol);
+
+stub_response mock_response(fault f, const std::string& symbol, const fault_rates& rates, std::mt19937& random);
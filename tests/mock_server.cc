@@ -0,0 +1,72 @@
+// Stand-in for the quote server, for running the dockapp or the fetcher against something
+// that misbehaves on demand. Serves the provider JSON for /SYMBOL until interrupted.
+//
+//   wmibov_mock_server [--port N] [--faults latency=0.1,drip=0.05,reset=0.01,status=0.02,
+//                      truncate=0.01,stall=0.01] [--latency MS] [--drip BYTES:MS] [--seed N]
+
+#include <signal.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+
+#include "mock_faults.h"
+
+int main(int argc, char *argv[])
+{
+    int port { 8080 };
+    fault_rates rates;
+    unsigned seed { 1 };
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--port") == 0 && i + 1 < argc) {
+            port = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--faults") == 0 && i + 1 < argc) {
+            if (!rates.parse(argv[++i])) {
+                std::cerr << "bad fault rates " << argv[i] << "\n";
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--latency") == 0 && i + 1 < argc) {
+            rates.latency_ms = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--drip") == 0 && i + 1 < argc) {
+            if (sscanf(argv[++i], "%d:%d", &rates.drip_bytes, &rates.drip_interval_ms) != 2) {
+                std::cerr << "bad drip " << argv[i] << "\n";
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = atoi(argv[++i]);
+        }
+    }
+
+    // handled below with sigwait, so block them before the stub's threads start
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &mask, nullptr);
+
+    std::mutex mutex;
+    std::mt19937 random { seed };
+
+    http_stub stub { [&](const std::string& path) {
+        const std::string symbol { path.substr(path.rfind('/') + 1) };
+        std::unique_lock<std::mutex> lock { mutex };
+        const fault f { rates.pick(random) };
+        return mock_response(f, symbol, rates, random);
+    }, port };
+
+    if (!stub.start()) {
+        std::cerr << "failed to listen on port " << port << "\n";
+        return 1;
+    }
+
+    std::cerr << "serving quotes on " << stub.url() << "\n";
+
+    int signal;
+    sigwait(&mask, &signal);
+
+    stub.stop();
+    std::cerr << stub.requests() << " requests\n";
+    return 0;
+}
@@ -0,0 +1,25 @@
+// libFuzzer entry point for the quote parser; built with clang as wmibov_parser_fuzz.
+// Crashes, sanitizer reports and results that depend on anything but the input are bugs.
+
+#include <cstdlib>
+#include <string>
+
+#include "quote_parser.h"
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    const char *text { reinterpret_cast<const char *>(data) };
+
+    quote_values first, second;
+    const parse_result result { parse_quote(text, size, first) };
+    if (parse_quote(text, size, second) != result)
+        abort();
+
+    if (result == parse_result::OK && (first.last != second.last || first.change != second.change || first.percent_change != second.percent_change))
+        abort();
+
+    std::string value;
+    parse_string_field(text, size, "symbol", value);
+
+    return 0;
+}
@@ -0,0 +1,157 @@
+#include <cstdlib>
+#include <random>
+#include <sstream>
+#include <string>
+
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/json_parser.hpp>
+
+#include <gtest/gtest.h>
+
+#include "quote_parser.h"
+
+namespace {
+
+parse_result parse(const std::string& text, quote_values& values)
+{
+    return parse_quote(text.data(), text.size(), values);
+}
+
+parse_result parse(const std::string& text)
+{
+    quote_values values;
+    return parse(text, values);
+}
+
+// the oracle for the fuzzer: property_tree's JSON parser, as the parser used to be
+bool ptree_accepts(const std::string& text, bool& is_object)
+{
+    try {
+        std::istringstream stream { text };
+        boost::property_tree::ptree tree;
+        boost::property_tree::read_json(stream, tree);
+        const auto first = text.find_first_not_of(" \t\r\n");
+        is_object = first != std::string::npos && text[first] == '{';
+        return true;
+    } catch (const boost::property_tree::json_parser_error&) {
+        return false;
+    }
+}
+
+const char *const seeds[] {
+    "{\"trdprc_1\":\"27.35\",\"netchng_1\":\"-0.42\",\"pctchng\":\"-1.51\"}",
+    "{\"trdprc_1\":27.35,\"netchng_1\":-0.42,\"pctchng\":-1.51}",
+    "{ \"name\" : \"PETR4\", \"tags\" : [true, false, null, 1e3, -0.5E-2, \"a\\\"b\\u00e9\"],\n"
+    "  \"nested\" : { \"a\" : [ { } , [ ] ] }, \"trdprc_1\" : 1234.5 }",
+    "[1, 2, {\"trdprc_1\": 3}]",
+};
+
+}
+
+TEST(parser, values)
+{
+    quote_values values;
+    ASSERT_EQ(parse(seeds[0], values), parse_result::OK);
+    EXPECT_EQ(values.last, decimal::from_units(27350000));
+    EXPECT_EQ(values.change, decimal::from_units(-420000));
+    EXPECT_EQ(values.percent_change, decimal::from_units(-1510000));
+
+    ASSERT_EQ(parse(seeds[1], values), parse_result::OK);
+    EXPECT_EQ(values.last, decimal::from_units(27350000));
+
+    ASSERT_EQ(parse(seeds[2], values), parse_result::OK);
+    EXPECT_EQ(values.last, decimal::from_units(1234500000));
+    EXPECT_EQ(values.change, decimal {});
+}
+
+TEST(parser, malformed)
+{
+    const char *const inputs[] {
+        "", " ", "{", "{\"x\"}", "{\"x\":}", "{\"x\":1,}", "{,}", "{\"x\":1}}", "{\"x\":1} x",
+        "{\"x\":-}", "{\"x\":+1}", "{\"x\":--1}", "{\"x\":1-2}", "{\"x\":01}", "{\"x\":1.}", "{\"x\":.5}",
+        "{\"x\":1e}", "{\"x\":1e+}", "{\"x\":1.e5}", "{\"x\":-.5}", "{\"x\":e5}", "{\"x\":0x10}",
+        "{\"x\":[1,]}", "{\"x\":[-]}", "{\"x\":tru}", "{\"x\":nul}", "{\"x\":\"a\\q\"}", "{\"x\":\"\\u12\"}",
+        "{\"x\":\"\\u12g4\"}", "{\"x\":\"a\nb\"}", "{\"x\":\"abc}", "{\"trdprc_1\":-}", "{\"trdprc_1\":1.}",
+        "{\"trdprc_1\":01}", "{\"trdprc_1\":\"1\"", "{\"x\":1 \"y\":2}",
+    };
+
+    for (auto input : inputs)
+        EXPECT_EQ(parse(input), parse_result::MALFORMED_JSON) << input;
+
+    EXPECT_EQ(parse("[1]"), parse_result::NOT_AN_OBJECT);
+    EXPECT_EQ(parse("}"), parse_result::NOT_AN_OBJECT);
+    EXPECT_EQ(parse("{\"trdprc_1\":true}"), parse_result::BAD_NUMBER);
+    EXPECT_EQ(parse("{\"trdprc_1\":\"1x\"}"), parse_result::BAD_NUMBER);
+    EXPECT_EQ(parse("{\"x\":-0.5e-3,\"y\":0,\"z\":1E+2}"), parse_result::OK);
+}
+
+TEST(parser, truncated)
+{
+    // no proper prefix of a document is one
+    for (auto seed : seeds) {
+        const std::string text { seed };
+        for (size_t size = 0; size < text.size(); ++size) {
+            if (text[0] == '{')
+                EXPECT_EQ(parse(text.substr(0, size)), parse_result::MALFORMED_JSON) << text.substr(0, size);
+            else
+                EXPECT_NE(parse(text.substr(0, size)), parse_result::OK) << text.substr(0, size);
+        }
+    }
+}
+
+// Mutates the seeds at random and checks the parser against the oracle: whatever it takes
+// as a whole document must be valid JSON, and it must take every valid object, if only to
+// reject its numbers. WMIBOV_FUZZ_ITERATIONS runs longer.
+
+TEST(parser, fuzz)
+{
+    const char *setting { getenv("WMIBOV_FUZZ_ITERATIONS") };
+    const long iterations { setting ? atol(setting) : 20000 };
+
+    const char alphabet[] { "{}[]\":,.-+0123456789eE \\u\nabtrnfl" };
+
+    std::mt19937 random { 12345 };
+    auto pick = [&](size_t count) { return std::uniform_int_distribution<size_t> { 0, count - 1 }(random); };
+
+    for (long i = 0; i < iterations; ++i) {
+        std::string text { seeds[pick(sizeof(seeds)/sizeof(*seeds))] };
+
+        for (size_t edits = 1 + pick(4); edits > 0 && !text.empty(); --edits) {
+            const size_t at { pick(text.size()) };
+            switch (pick(4)) {
+            case 0:
+                text[at] = alphabet[pick(sizeof(alphabet) - 1)];
+                break;
+            case 1:
+                text.insert(at, 1, alphabet[pick(sizeof(alphabet) - 1)]);
+                break;
+            case 2:
+                text.erase(at, 1 + pick(3));
+                break;
+            case 3:
+                text.resize(at);
+                break;
+            }
+        }
+
+        // the parser must never read past the end, so give it a copy without slack
+        std::unique_ptr<char[]> copy { new char[text.size()] };
+        memcpy(copy.get(), text.data(), text.size());
+
+        quote_values values;
+        const parse_result result { parse_quote(copy.get(), text.size(), values) };
+
+        bool is_object;
+        const bool valid { ptree_accepts(text, is_object) };
+
+        if (result == parse_result::OK) {
+            ASSERT_TRUE(valid && is_object) << text;
+        }
+        if (valid && is_object) {
+            ASSERT_NE(result, parse_result::MALFORMED_JSON) << text;
+        }
+
+        std::string name;
+        parse_string_field(copy.get(), text.size(), "name", name);
+    }
+}
@@ -0,0 +1,106 @@
+#include <set>
+
+#include <gtest/gtest.h>
+
+#include "image_target.h"
+#include "quote_renderer.h"
+
+namespace {
+
+const uint32_t BLACK { 0x000000 };
+const uint32_t WHITE { 0xffffff };
+const uint32_t GREEN { 0x00ff00 };
+const uint32_t RED { 0xff0000 };
+const uint32_t YELLOW { 0xffff00 };
+const uint32_t GRAPH { 0x999999 };
+
+std::set<uint32_t> colors(const image_target& image)
+{
+    return std::set<uint32_t>(image.pixels(), image.pixels() + image_target::SIZE*image_target::SIZE);
+}
+
+struct render_fixture : testing::Test
+{
+    render_fixture()
+    {
+        table.add("PETR4", id);
+        history.add_quote();
+    }
+
+    quote_snapshot fetched(int64_t last, int64_t change)
+    {
+        quote_snapshot quote;
+        quote.last = decimal::from_units(last);
+        quote.change = decimal::from_units(change);
+        quote.percent_change = decimal::from_units(change/10);
+        quote.status = quote_status::FETCHED;
+        format_quote(quote.last, quote.change, quote.percent_change, quote.text);
+        return quote;
+    }
+
+    quote_table table;
+    quote_history history;
+    quote_id id;
+    const quote_renderer renderer { table, history };
+    image_target image;
+};
+
+}
+
+TEST_F(render_fixture, wait_frame)
+{
+    renderer.compose(image, id, quote_snapshot {}, font_color::NONE);
+    EXPECT_EQ(colors(image), (std::set<uint32_t> { BLACK, WHITE, YELLOW }));
+}
+
+TEST_F(render_fixture, error_frame)
+{
+    quote_snapshot quote;
+    quote.status = quote_status::ERROR;
+    renderer.compose(image, id, quote, font_color::NONE);
+    EXPECT_EQ(colors(image), (std::set<uint32_t> { BLACK, WHITE, RED }));
+}
+
+TEST_F(render_fixture, change_colors)
+{
+    renderer.compose(image, id, fetched(27350000, 420000), font_color::NONE);
+    EXPECT_EQ(colors(image), (std::set<uint32_t> { BLACK, WHITE, GREEN }));
+
+    renderer.compose(image, id, fetched(27350000, -420000), font_color::NONE);
+    EXPECT_EQ(colors(image), (std::set<uint32_t> { BLACK, WHITE, RED }));
+
+    auto stale = fetched(27350000, 420000);
+    stale.stale = true;
+    renderer.compose(image, id, stale, font_color::NONE);
+    EXPECT_EQ(colors(image), (std::set<uint32_t> { BLACK, WHITE, YELLOW }));
+}
+
+TEST_F(render_fixture, flash_overrides_every_color)
+{
+    renderer.compose(image, id, fetched(27350000, 420000), font_color::RED);
+    EXPECT_EQ(colors(image), (std::set<uint32_t> { BLACK, RED }));
+}
+
+TEST_F(render_fixture, values_change_the_frame)
+{
+    image_target other;
+    renderer.compose(image, id, fetched(27350000, 420000), font_color::NONE);
+    renderer.compose(other, id, fetched(27350000, 420000), font_color::NONE);
+    EXPECT_EQ(image, other);
+
+    renderer.compose(other, id, fetched(27360000, 430000), font_color::NONE);
+    EXPECT_NE(image, other);
+}
+
+TEST_F(render_fixture, sparkline)
+{
+    for (int i = 0; i < 10; ++i)
+        history.push(id, i, decimal::from_units(27000000 + i*10000));
+
+    renderer.compose(image, id, fetched(27090000, 420000), font_color::NONE);
+    EXPECT_EQ(colors(image).count(GRAPH), 1u);
+
+    // rising prices end at the top of the strip, in the rightmost column
+    EXPECT_EQ(image.pixel(59, 56), GRAPH);
+    EXPECT_EQ(image.pixel(50, 59), GRAPH);
+}
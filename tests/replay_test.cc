@@ -0,0 +1,62 @@
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "engine_runner.h"
+#include "quote_log.h"
+
+namespace {
+
+const char *QUOTE_BODY { "{\"trdprc_1\":\"10.00\",\"netchng_1\":\"0.10\",\"pctchng\":\"1.01\"}" };
+
+// removes the log when done
+struct test_log
+{
+    explicit test_log(const char *test)
+        : path { "/tmp/wmibov-test-" + std::string { test } + "-" + std::to_string(getpid()) + ".log" } {}
+    ~test_log() { unlink(path.c_str()); }
+
+    std::string path;
+};
+
+}
+
+TEST(replay, stamps_quotes_with_the_recorded_time)
+{
+    const time_t RECORDED { 1000000000 };
+
+    test_log log { "replay" };
+    {
+        quote_log_writer writer;
+        ASSERT_TRUE(writer.open(log.path));
+        const std::string body { QUOTE_BODY };
+        writer.write(int64_t { RECORDED }*1000000, 0, false, "PETR4", body.data(), body.size());
+        writer.write(int64_t { RECORDED + 60 }*1000000, 0, false, "VALE3", body.data(), body.size());
+        writer.write(int64_t { RECORDED + 120 }*1000000, 0, true, "PETR4", nullptr, 0);
+    }
+
+    quote_engine engine;
+    ASSERT_TRUE(engine.initialize());
+    engine.add_provider(std::unique_ptr<quote_provider> { new json_quote_provider { "stub", "http://127.0.0.1:9/", quote_fields {} } });
+    ASSERT_TRUE(engine.enable_replay(log.path, 0));
+    engine.configure(test_config({}, 30));
+    engine.start();
+
+    engine_runner runner { engine };
+    ASSERT_TRUE(runner.run_until([&] { return engine.stopped(); }, std::chrono::seconds { 5 }));
+
+    const auto& quotes = engine.quotes();
+    quote_id petr4, vale3;
+    ASSERT_TRUE(quotes.find("PETR4", petr4));
+    ASSERT_TRUE(quotes.find("VALE3", vale3));
+
+    const auto petr4_quote = quotes.snapshot[petr4].load();
+    const auto vale3_quote = quotes.snapshot[vale3].load();
+    EXPECT_EQ(petr4_quote.status, quote_status::FETCHED);
+    EXPECT_EQ(petr4_quote.last_update, RECORDED + 120);
+    EXPECT_EQ(vale3_quote.last_update, RECORDED + 60);
+}
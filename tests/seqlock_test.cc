@@ -0,0 +1,129 @@
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "seqlock.h"
+#include "quote_table.h"
+
+namespace {
+
+// Every word of a store holds the same counter, so a torn read shows up as words that
+// disagree. WMIBOV_STRESS_SECONDS runs longer.
+
+struct wide_value
+{
+    uint64_t words[15];
+    uint32_t tail[3];
+};
+
+std::chrono::milliseconds stress_duration()
+{
+    const char *seconds { getenv("WMIBOV_STRESS_SECONDS") };
+    return std::chrono::milliseconds { seconds ? atoi(seconds)*1000 : 500 };
+}
+
+template <typename T, typename Make, typename Check>
+void stress(seqlock<T>& lock, Make make, Check check)
+{
+    const unsigned readers { std::max(2u, std::thread::hardware_concurrency()) - 1 };
+
+    std::atomic<bool> done { false };
+    std::atomic<uint64_t> torn { 0 }, backwards { 0 }, loads { 0 };
+
+    std::vector<std::thread> threads;
+    for (unsigned i = 0; i < readers; ++i) {
+        threads.emplace_back([&] {
+            uint64_t last { 0 }, count { 0 };
+            while (!done) {
+                const T value { lock.load() };
+                uint64_t counter;
+                if (!check(value, counter))
+                    ++torn;
+                else if (counter < last)
+                    ++backwards;
+                else
+                    last = counter;
+                ++count;
+            }
+            loads += count;
+        });
+    }
+
+    const auto deadline = std::chrono::steady_clock::now() + stress_duration();
+    uint64_t stores { 0 };
+    while (std::chrono::steady_clock::now() < deadline) {
+        for (int i = 0; i < 1000; ++i)
+            lock.store(make(++stores));
+    }
+
+    done = true;
+    for (auto& t : threads)
+        t.join();
+
+    EXPECT_EQ(torn, 0u);
+    EXPECT_EQ(backwards, 0u);
+    EXPECT_GT(loads, 0u);
+    EXPECT_GT(stores, 0u);
+}
+
+}
+
+TEST(seqlock, wide_value_is_never_torn)
+{
+    seqlock<wide_value> lock;
+
+    stress(lock, [](uint64_t counter) {
+        wide_value value;
+        for (auto& word : value.words)
+            word = counter;
+        for (auto& word : value.tail)
+            word = static_cast<uint32_t>(counter);
+        return value;
+    }, [](const wide_value& value, uint64_t& counter) {
+        counter = value.words[0];
+        for (auto word : value.words) {
+            if (word != counter)
+                return false;
+        }
+        for (auto word : value.tail) {
+            if (word != static_cast<uint32_t>(counter))
+                return false;
+        }
+        return true;
+    });
+}
+
+TEST(seqlock, snapshot_matches_its_text)
+{
+    // the real payload: the display strings have to belong to the values next to them
+
+    seqlock<quote_snapshot> lock;
+
+    stress(lock, [](uint64_t counter) {
+        quote_snapshot quote;
+        quote.last = decimal::from_units(counter*10000);
+        quote.change = decimal::from_units(counter*10000);
+        quote.percent_change = decimal::from_units(counter*10000);
+        quote.last_update = counter;
+        quote.received = counter;
+        quote.status = quote_status::FETCHED;
+        format_quote(quote.last, quote.change, quote.percent_change, quote.text);
+        return quote;
+    }, [](const quote_snapshot& quote, uint64_t& counter) {
+        counter = quote.received;
+        if (quote.status == quote_status::NONE)
+            return counter == 0;
+
+        quote_text expected;
+        format_quote(quote.last, quote.change, quote.percent_change, expected);
+        return quote.last == decimal::from_units(counter*10000) && quote.change == quote.last &&
+            quote.percent_change == quote.last && quote.last_update == static_cast<time_t>(counter) &&
+            !strcmp(expected.last, quote.text.last) && !strcmp(expected.change, quote.text.change) &&
+            !strcmp(expected.percent_change, quote.text.percent_change);
+    });
+}
@@ -0,0 +1,223 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "engine_runner.h"
+#include "http_stub.h"
+#include "image_target.h"
+#include "quote_renderer.h"
+
+namespace {
+
+using steady_clock = std::chrono::steady_clock;
+
+const int TICKS { 20 };
+
+// tick i moves the price to 10.00 + i cents
+decimal tick_price(int i)
+{
+    return decimal::from_units(10*decimal::SCALE + i*decimal::SCALE/100);
+}
+
+std::string tick_event(const std::string& symbol, int i)
+{
+    char data[160];
+    snprintf(data, sizeof(data), "data: {\"symbol\":\"%s\",\"trdprc_1\":\"10.%02d\",\"netchng_1\":\"0.%02d\",\"pctchng\":\"0.%02d\"}\n\n",
+             symbol.c_str(), i, i, i);
+    return data;
+}
+
+// a stand-in for the streaming server on /stream, and the polling one everywhere else
+struct sse_server
+{
+    explicit sse_server(std::function<void(stub_writer&)> stream)
+        : stub { [this, stream](const std::string& path) {
+            if (path.compare(0, 7, "/stream") != 0)
+                return stub_response { 200, "{\"trdprc_1\":\"10.00\",\"netchng_1\":\"0.00\",\"pctchng\":\"0.00\"}" };
+
+            {
+                std::unique_lock<std::mutex> lock { mutex };
+                stream_paths.push_back(path);
+            }
+
+            stub_response response { 200, "", { "Content-Type: text/event-stream" } };
+            response.stream = stream;
+            return response;
+        } }
+    {
+    }
+
+    size_t connections()
+    {
+        std::unique_lock<std::mutex> lock { mutex };
+        return stream_paths.size();
+    }
+
+    std::mutex mutex;
+    std::vector<std::string> stream_paths;
+    http_stub stub;
+};
+
+bool keep_alive(stub_writer& writer)
+{
+    while (writer.pause(200)) {
+        if (!writer.write(": keepalive\n\n"))
+            return false;
+    }
+    return false;
+}
+
+void start_engine(quote_engine& engine, sse_server& server, const std::vector<std::string>& symbols)
+{
+    ASSERT_TRUE(engine.initialize());
+    engine.add_provider(std::unique_ptr<quote_provider> { new json_quote_provider { "stub", server.stub.url(), quote_fields {} } });
+
+    stream_config stream;
+    stream.url = server.stub.url() + "stream";
+    ASSERT_TRUE(engine.enable_stream(stream, 2, 5));
+
+    engine.configure(test_config(symbols, 30));
+    engine.start();
+}
+
+}
+
+// Each tick the server sends has to reach the quote's frame: measured from writing the
+// event to composing a frame that shows it, through curl, the feed, the completion pipe, the
+// loop and the renderer.
+
+TEST(stream, tick_to_pixel)
+{
+    std::mutex mutex;
+    std::vector<steady_clock::time_point> sent(TICKS);
+
+    sse_server server { [&](stub_writer& writer) {
+        for (int i = 0; i < TICKS; ++i) {
+            if (!writer.pause(50))
+                return;
+            {
+                std::unique_lock<std::mutex> lock { mutex };
+                sent[i] = steady_clock::now();
+            }
+            if (!writer.write(tick_event("PETR4", i)))
+                return;
+        }
+        keep_alive(writer);
+    } };
+    ASSERT_TRUE(server.stub.start());
+
+    quote_engine engine;
+    start_engine(engine, server, { "PETR4" });
+
+    quote_id id;
+    ASSERT_TRUE(engine.quotes().find("PETR4", id));
+
+    const quote_renderer renderer { engine.quotes(), engine.history() };
+    image_target frame, expected, previous;
+
+    std::vector<double> latencies;
+    int shown { -1 };
+
+    engine_runner runner { engine };
+    ASSERT_TRUE(runner.run_until([&] {
+        if (std::find(runner.updated.begin(), runner.updated.end(), id) == runner.updated.end())
+            return false;
+
+        const auto quote = engine.quotes().snapshot[id].load();
+        renderer.compose(frame, id, quote, font_color::NONE);
+        const auto drawn = steady_clock::now();
+
+        // which tick is on screen; ticks that came in between frames are coalesced
+        int tick { -1 };
+        for (int i = 0; i < TICKS; ++i) {
+            if (quote.last == tick_price(i))
+                tick = i;
+        }
+        if (tick <= shown)
+            return false;
+
+        quote_snapshot ideal { quote };
+        ideal.last = tick_price(tick);
+        ideal.change = ideal.percent_change = decimal::from_units(tick*decimal::SCALE/100);
+        format_quote(ideal.last, ideal.change, ideal.percent_change, ideal.text);
+        renderer.compose(expected, id, ideal, font_color::NONE);
+        EXPECT_EQ(frame, expected) << "tick " << tick;
+        EXPECT_NE(frame, previous) << "tick " << tick;
+        previous = frame;
+
+        steady_clock::time_point sent_at;
+        {
+            std::unique_lock<std::mutex> lock { mutex };
+            sent_at = sent[tick];
+        }
+        if (tick > 0)
+            latencies.push_back(std::chrono::duration<double, std::milli> { drawn - sent_at }.count());
+
+        shown = tick;
+        return shown == TICKS - 1;
+    }, std::chrono::seconds { 10 }));
+
+    ASSERT_FALSE(latencies.empty());
+    std::sort(latencies.begin(), latencies.end());
+    const double median { latencies[latencies.size()/2] }, worst { latencies.back() };
+
+    RecordProperty("ticks_shown", static_cast<int>(latencies.size()));
+    RecordProperty("median_us", static_cast<int>(median*1000));
+    RecordProperty("max_us", static_cast<int>(worst*1000));
+
+    // the loop sleeps on the pipe, so a tick is on screen as soon as it's parsed
+    EXPECT_LT(worst, 250.0);
+}
+
+TEST(stream, drops_a_line_that_never_ends)
+{
+    // the first connection sends a line without end, the next one a proper tick
+    std::atomic<int> connection { 0 };
+
+    sse_server server { [&](stub_writer& writer) {
+        if (connection++ == 0) {
+            const std::string junk(16*1024, 'x');
+            writer.write("data: ");
+            for (int i = 0; i < 16 && writer.write(junk); ++i)
+                ;
+            keep_alive(writer);
+            return;
+        }
+        writer.write(tick_event("PETR4", 7));
+        keep_alive(writer);
+    } };
+    ASSERT_TRUE(server.stub.start());
+
+    quote_engine engine;
+    start_engine(engine, server, { "PETR4" });
+
+    quote_id id;
+    ASSERT_TRUE(engine.quotes().find("PETR4", id));
+
+    engine_runner runner { engine };
+    EXPECT_TRUE(runner.run_until([&] { return engine.quotes().snapshot[id].load().last == tick_price(7); }, std::chrono::seconds { 10 }));
+    EXPECT_GE(server.connections(), 2u);
+}
+
+TEST(stream, escapes_symbols)
+{
+    sse_server server { keep_alive };
+    ASSERT_TRUE(server.stub.start());
+
+    quote_engine engine;
+    start_engine(engine, server, { "A&B", "C D", "PETR4" });
+
+    engine_runner runner { engine };
+    ASSERT_TRUE(runner.run_until([&] { return server.connections() > 0; }, std::chrono::seconds { 5 }));
+
+    std::unique_lock<std::mutex> lock { server.mutex };
+    const std::string& path = server.stream_paths.front();
+    EXPECT_NE(path.find("A%26B"), std::string::npos) << path;
+    EXPECT_NE(path.find("C%20D"), std::string::npos) << path;
+    EXPECT_EQ(path.find(' '), std::string::npos) << path;
+}
@@ -0,0 +1,262 @@
+// Drives rounds of symbol refreshes through quote_fetcher and curl against the mock server,
+// each symbol misbehaving as the fault rates say, and reports latency percentiles and
+// whether every fetch came back the way its fault calls for: exactly one answer, with the
+// right values when the server answered and an error when it didn't. Exits 1 if not.
+//
+//   wmibov_stress [--symbols N] [--rounds N] [--max-requests N] [--budget MS]
+//                 [--faults SPEC] [--latency MS] [--drip BYTES:MS] [--seed N] [--json]
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <vector>
+
+#include <curl/curl.h>
+
+#include "mock_faults.h"
+#include "quote_fetcher.h"
+#include "quote_parser.h"
+
+namespace {
+
+using steady_clock = std::chrono::steady_clock;
+
+// what came back for each quote this round
+class recording_sink : public quote_sink
+{
+public:
+    explicit recording_sink(size_t count)
+        : m_answers(count), m_errors(count), m_values(count), m_times(count)
+    {
+    }
+
+    void start_round()
+    {
+        std::unique_lock<std::mutex> lock { m_mutex };
+        std::fill(m_answers.begin(), m_answers.end(), 0);
+        m_answered = 0;
+    }
+
+    // false if some never answered in time
+    bool wait(steady_clock::time_point deadline)
+    {
+        std::unique_lock<std::mutex> lock { m_mutex };
+        return m_condition.wait_until(lock, deadline, [&] { return m_answered == m_answers.size(); });
+    }
+
+    void set_quote_state(quote_id id, decimal last, decimal change, decimal percent_change) override
+    {
+        answer(id, false, quote_values { last, change, percent_change });
+    }
+
+    void set_quote_unchanged(quote_id id) override
+    {
+        answer(id, false, m_values[id]);
+    }
+
+    void set_quote_error(quote_id id) override
+    {
+        answer(id, true, quote_values {});
+    }
+
+    void set_replay_time(time_t) override {}
+    void set_replay_done() override {}
+
+    // only read between rounds
+    std::vector<int> m_answers;
+    std::vector<uint8_t> m_errors;
+    std::vector<quote_values> m_values;
+    std::vector<steady_clock::time_point> m_times;
+
+private:
+    void answer(quote_id id, bool error, const quote_values& values)
+    {
+        std::unique_lock<std::mutex> lock { m_mutex };
+        if (m_answers[id]++ == 0)
+            ++m_answered;
+        m_errors[id] = error;
+        m_values[id] = values;
+        m_times[id] = steady_clock::now();
+        m_condition.notify_one();
+    }
+
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    size_t m_answered = 0;
+};
+
+double percentile(std::vector<double>& samples, double p)
+{
+    if (samples.empty())
+        return 0;
+    std::sort(samples.begin(), samples.end());
+    return samples[std::min(samples.size() - 1, static_cast<size_t>(p*samples.size()))];
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    int symbols { 256 };
+    int rounds { 10 };
+    int max_requests { 8 };
+    int budget_ms { 1000 };
+    unsigned seed { 1 };
+    bool json { false };
+
+    fault_rates rates;
+    rates.parse("latency=0.05,drip=0.05,reset=0.02,status=0.03,truncate=0.02,stall=0.01");
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--symbols") == 0 && i + 1 < argc)
+            symbols = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--rounds") == 0 && i + 1 < argc)
+            rounds = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--max-requests") == 0 && i + 1 < argc)
+            max_requests = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--budget") == 0 && i + 1 < argc)
+            budget_ms = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--faults") == 0 && i + 1 < argc) {
+            rates = fault_rates {};
+            if (!rates.parse(argv[++i])) {
+                std::cerr << "bad fault rates " << argv[i] << "\n";
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--latency") == 0 && i + 1 < argc)
+            rates.latency_ms = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--drip") == 0 && i + 1 < argc)
+            sscanf(argv[++i], "%d:%d", &rates.drip_bytes, &rates.drip_interval_ms);
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+            seed = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--json") == 0)
+            json = true;
+    }
+
+    curl_global_init(CURL_GLOBAL_ALL);
+
+    std::vector<std::string> names;
+    std::vector<quote_values> expected(symbols);
+    for (int i = 0; i < symbols; ++i) {
+        names.push_back("MOCK" + std::to_string(i));
+        const std::string body { mock_quote_body(names.back()) };
+        parse_quote(body.data(), body.size(), expected[i]);
+    }
+
+    // the fault for each symbol this round, so that curl retrying a request sees the same one
+    std::mutex mutex;
+    std::vector<fault> plan(symbols, fault::NONE);
+    std::mt19937 random { seed };
+
+    http_stub stub { [&](const std::string& path) {
+        const std::string symbol { path.substr(path.rfind('/') + 1) };
+        const int id { atoi(symbol.c_str() + 4) };
+        std::unique_lock<std::mutex> lock { mutex };
+        return mock_response(plan[id], symbol, rates, random);
+    } };
+
+    if (!stub.start()) {
+        std::cerr << "failed to start the mock server\n";
+        return 1;
+    }
+
+    size_t fetches { 0 }, wrong { 0 }, missing { 0 }, duplicates { 0 };
+    size_t injected[static_cast<int>(fault::COUNT)] {};
+    std::vector<double> answered_ms, failed_ms;
+
+    const auto started = steady_clock::now();
+
+    {
+        recording_sink sink { static_cast<size_t>(symbols) };
+        quote_fetcher fetcher { sink };
+        fetcher.add_provider(std::unique_ptr<quote_provider> { new json_quote_provider { "mock", stub.url(), quote_fields {} } });
+        fetcher.set_max_requests(max_requests);
+        for (int i = 0; i < symbols; ++i)
+            fetcher.add_quote(i, names[i]);
+
+        for (int round = 0; round < rounds; ++round) {
+            {
+                std::unique_lock<std::mutex> lock { mutex };
+                for (auto& f : plan) {
+                    f = rates.pick(random);
+                    ++injected[static_cast<int>(f)];
+                }
+            }
+
+            sink.start_round();
+
+            const auto round_start = steady_clock::now();
+            for (int i = 0; i < symbols; ++i)
+                fetcher.fetch(i, std::chrono::milliseconds { budget_ms });
+
+            // every fetch has to answer within its budget, with some slack for the queue
+            if (!sink.wait(round_start + std::chrono::milliseconds { 2*budget_ms + 5000 })) {
+                for (int i = 0; i < symbols; ++i) {
+                    if (sink.m_answers[i] == 0)
+                        fetcher.cancel(i);
+                }
+            }
+
+            for (int i = 0; i < symbols; ++i) {
+                ++fetches;
+
+                if (sink.m_answers[i] == 0) {
+                    ++missing;
+                    continue;
+                }
+                if (sink.m_answers[i] > 1)
+                    ++duplicates;
+
+                const double ms { std::chrono::duration<double, std::milli> { sink.m_times[i] - round_start }.count() };
+                const auto& values = sink.m_values[i];
+
+                if (fault_answers(plan[i])) {
+                    answered_ms.push_back(ms);
+                    if (sink.m_errors[i] || values.last != expected[i].last || values.change != expected[i].change ||
+                        values.percent_change != expected[i].percent_change)
+                        ++wrong;
+                } else {
+                    failed_ms.push_back(ms);
+                    if (!sink.m_errors[i])
+                        ++wrong;
+                }
+            }
+        }
+    }
+
+    const double seconds { std::chrono::duration<double> { steady_clock::now() - started }.count() };
+    stub.stop();
+    curl_global_cleanup();
+
+    const bool ok { wrong == 0 && missing == 0 && duplicates == 0 };
+    const size_t answered { answered_ms.size() }, failed { failed_ms.size() };
+
+    // the percentiles sort the samples, so take them in order
+    const double answered_p[] { percentile(answered_ms, 0.5), percentile(answered_ms, 0.9), percentile(answered_ms, 0.99), percentile(answered_ms, 1) };
+    const double failed_p[] { percentile(failed_ms, 0.5), percentile(failed_ms, 0.9), percentile(failed_ms, 0.99), percentile(failed_ms, 1) };
+
+    if (json) {
+        std::cout << "{\"fetches\":" << fetches << ",\"seconds\":" << seconds << ",\"fetches_per_second\":" << fetches/seconds
+                  << ",\"answered\":" << answered << ",\"failed\":" << failed
+                  << ",\"wrong\":" << wrong << ",\"missing\":" << missing << ",\"duplicates\":" << duplicates << ",\"injected\":{";
+        for (int i = 0; i < static_cast<int>(fault::COUNT); ++i)
+            std::cout << (i ? "," : "") << "\"" << fault_name(static_cast<fault>(i)) << "\":" << injected[i];
+        std::cout << "},\"answered_ms\":{\"p50\":" << answered_p[0] << ",\"p90\":" << answered_p[1] << ",\"p99\":" << answered_p[2] << ",\"max\":" << answered_p[3]
+                  << "},\"failed_ms\":{\"p50\":" << failed_p[0] << ",\"p90\":" << failed_p[1] << ",\"p99\":" << failed_p[2] << ",\"max\":" << failed_p[3]
+                  << "},\"ok\":" << (ok ? "true" : "false") << "}\n";
+    } else {
+        std::cout << fetches << " fetches in " << seconds << " s (" << fetches/seconds << "/s)\n";
+        std::cout << "injected:";
+        for (int i = 0; i < static_cast<int>(fault::COUNT); ++i)
+            std::cout << " " << fault_name(static_cast<fault>(i)) << "=" << injected[i];
+        std::cout << "\n";
+        std::cout << "answered " << answered << ", ms p50 " << answered_p[0] << " p90 " << answered_p[1] << " p99 " << answered_p[2] << " max " << answered_p[3] << "\n";
+        std::cout << "failed " << failed << ", ms p50 " << failed_p[0] << " p90 " << failed_p[1] << " p99 " << failed_p[2] << " max " << failed_p[3] << "\n";
+        std::cout << "wrong " << wrong << ", missing " << missing << ", duplicates " << duplicates << (ok ? ": ok" : ": FAILED") << "\n";
+    }
+
+    return ok ? 0 : 1;
+}
@@ -1,11 +1,7 @@
 #include <iostream>
-#include <cmath>
-
-#include <boost/format.hpp>
-#include <boost/lexical_cast.hpp>
+#include <algorithm>
 
 #include "wm_window.h"
-#include "quote_fetcher.h"
 
 #include "mask.xbm"
 #include "font_white.xpm"
@@ -13,8 +9,11 @@
 #include "font_red.xpm"
 #include "font_yellow.xpm"
 
-wm_window::wm_window()
-    : m_quote_fetcher { new quote_fetcher { *this } }
+wm_window::wm_window(quote_engine& engine)
+    : m_engine { engine }
+    , m_quotes { engine.quotes() }
+    , m_history { engine.history() }
+    , m_renderer { m_quotes, m_history }
 {
 }
 
@@ -37,6 +36,7 @@ bool wm_window::initialize(int argc, char *argv[])
 
     m_white_pixel = get_color("white");
     m_black_pixel = get_color("black");
+    m_graph_pixel = get_color("gray60");
 
     m_delete_window = XInternAtom(m_display, "WM_DELETE_WINDOW", False);
 
@@ -49,26 +49,9 @@ bool wm_window::initialize(int argc, char *argv[])
     return true;
 }
 
-void wm_window::add_quote(const std::string& symbol)
-{
-    quote_state quote;
-    quote.symbol = symbol;
-    m_quotes.push_back(quote);
-}
-
-void wm_window::set_update_interval(time_t update_interval)
-{
-    m_update_interval = update_interval;
-}
-
-void wm_window::set_retry_interval(time_t retry_interval)
-{
-    m_retry_interval = retry_interval;
-}
-
-void wm_window::set_max_retries(int max_retries)
+void wm_window::set_verbose(bool verbose)
 {
-    m_max_retries = max_retries;
+    m_verbose = verbose;
 }
 
 Pixel wm_window::get_color(const char *name)
@@ -174,218 +157,238 @@ bool wm_window::init_window(int argc, char *argv[])
 
 bool wm_window::init_pixmaps()
 {
-    m_visible_pixmap = XCreatePixmap(m_display, m_root_window, WINDOW_SIZE, WINDOW_SIZE, DefaultDepth(m_display, DefaultScreen(m_display)));
-
     XpmAttributes xpm_attribs;
     xpm_attribs.valuemask = XpmReturnPixels | XpmReturnExtensions | XpmExactColors | XpmCloseness;
     xpm_attribs.exactColors = False;
     xpm_attribs.closeness = 40000;
 
-    XpmCreatePixmapFromData(m_display, m_root_window, font_white, &m_white_font_pixmap, nullptr, &xpm_attribs);
-    XpmCreatePixmapFromData(m_display, m_root_window, font_green, &m_green_font_pixmap, nullptr, &xpm_attribs);
-    XpmCreatePixmapFromData(m_display, m_root_window, font_red, &m_red_font_pixmap, nullptr, &xpm_attribs);
-    XpmCreatePixmapFromData(m_display, m_root_window, font_yellow, &m_yellow_font_pixmap, nullptr, &xpm_attribs);
+    auto font_pixmap = [this](font_color color) -> Pixmap& { return m_font_pixmaps[static_cast<int>(color)]; };
+
+    XpmCreatePixmapFromData(m_display, m_root_window, font_white, &font_pixmap(font_color::WHITE), nullptr, &xpm_attribs);
+    XpmCreatePixmapFromData(m_display, m_root_window, font_green, &font_pixmap(font_color::GREEN), nullptr, &xpm_attribs);
+    XpmCreatePixmapFromData(m_display, m_root_window, font_red, &font_pixmap(font_color::RED), nullptr, &xpm_attribs);
+    XpmCreatePixmapFromData(m_display, m_root_window, font_yellow, &font_pixmap(font_color::YELLOW), nullptr, &xpm_attribs);
+    font_pixmap(font_color::NONE) = None;
 
     return true;
 }
 
-void wm_window::redraw_window()
+namespace {
+
+// draws onto a pixmap, copying glyphs out of the font pixmaps
+
+class pixmap_target : public render_target
 {
-    XSetForeground(m_display, m_normal_gc, m_black_pixel);
-    XFillRectangle(m_display, m_visible_pixmap, m_normal_gc, 0, 0, WINDOW_SIZE, WINDOW_SIZE);
-
-    if (m_cur_quote < m_quotes.size()) {
-        quote_state quote;
-        {
-            std::unique_lock<std::mutex> lock { m_mutex };
-            quote = m_quotes[m_cur_quote];
-        }
-        if (quote.last_update == static_cast<time_t>(0) || quote.state == quote_state::WAITING)
-            draw_wait(quote.symbol);
-        else if (quote.state == quote_state::ERROR)
-            draw_error(quote.symbol);
-        else
-            draw_quote(quote.symbol, quote.last, quote.change, quote.percent_change);
+public:
+    pixmap_target(Display *display, GC gc, const Pixmap *font_pixmaps, Pixel black, Pixel graph, Pixmap target)
+        : m_display { display }, m_gc { gc }, m_font_pixmaps { font_pixmaps }
+        , m_black_pixel { black }, m_graph_pixel { graph }, m_target { target }
+    {
     }
 
-    XEvent event;
-    while (XCheckTypedWindowEvent(m_display, m_icon_window, Expose, &event))
-        ;
-    XCopyArea(m_display, m_visible_pixmap, m_icon_window, m_normal_gc, 0, 0, WINDOW_SIZE, WINDOW_SIZE, 0, 0);
+    void clear() override
+    {
+        XSetForeground(m_display, m_gc, m_black_pixel);
+        XFillRectangle(m_display, m_target, m_gc, 0, 0, quote_renderer::WINDOW_SIZE, quote_renderer::WINDOW_SIZE);
+    }
 
-    while (XCheckTypedWindowEvent(m_display, m_window, Expose, &event))
-        ;
-    XCopyArea(m_display, m_visible_pixmap, m_window, m_normal_gc, 0, 0, WINDOW_SIZE, WINDOW_SIZE, 0, 0);
-}
+    void draw_glyph(font_color font, int column, int row, int x, int y) override
+    {
+        XCopyArea(m_display, m_font_pixmaps[static_cast<int>(font)], m_target, m_gc,
+                  column*quote_renderer::GLYPH_WIDTH, row*quote_renderer::GLYPH_HEIGHT,
+                  quote_renderer::GLYPH_WIDTH, quote_renderer::GLYPH_HEIGHT,
+                  x, y);
+    }
 
-void wm_window::draw_string(Pixmap font_pixmap, const std::string& text, int x, int y) const
-{
-    static const std::string font_chars { " !\"#$%&'()*+,-./0123456789:;<=>?"
-                                          "@ABCDEFGHIJKLMNOPQRSTUVWXYZ[\\]^_"
-                                          "`abcdefghijklmnopqrstuvwxyz{|}~*" };
-    static const int chars_per_row { 32 };
-
-    for (auto ch : text) {
-        const auto pos { font_chars.find(ch) };
-
-        if (pos != std::string::npos) {
-            const auto char_col { pos%chars_per_row };
-            const auto char_row { pos/chars_per_row };
-
-            XCopyArea(m_display, font_pixmap, m_visible_pixmap, m_normal_gc,
-                      char_col*CHAR_WIDTH, char_row*CHAR_HEIGHT,
-                      CHAR_WIDTH, CHAR_HEIGHT,
-                      x, y);
+    void draw_lines(const render_point *points, size_t count) override
+    {
+        XPoint xpoints[quote_renderer::WINDOW_SIZE];
+        if (count > quote_renderer::WINDOW_SIZE)
+            count = quote_renderer::WINDOW_SIZE;
+
+        for (size_t i = 0; i < count; ++i) {
+            xpoints[i].x = points[i].x;
+            xpoints[i].y = points[i].y;
         }
 
-        x += CHAR_WIDTH;
+        XSetForeground(m_display, m_gc, m_graph_pixel);
+        XDrawLines(m_display, m_target, m_gc, xpoints, count, CoordModeOrigin);
     }
-}
 
-void wm_window::draw_string_centered(Pixmap font_pixmap, const std::string& text, int y) const
-{
-      draw_string(font_pixmap, text, (WINDOW_SIZE - text.size()*CHAR_WIDTH)/2, y);
+private:
+    Display *m_display;
+    GC m_gc;
+    const Pixmap *m_font_pixmaps;
+    Pixel m_black_pixel, m_graph_pixel;
+    Pixmap m_target;
+};
+
 }
 
-void wm_window::draw_quote(const std::string& symbol, double last, double change, double percent_change) const
+void wm_window::redraw_window()
 {
-    std::string last_str, change_str;
-
-    if (last >= 100) {
-        const auto ilast { std::lround(last) };
-        const auto ichange { std::lround(change) };
-
-        if (ilast >= 1000)
-            last_str = (boost::format { "%d,%03d" } % (ilast / 1000) % (ilast % 1000)).str();
-        else
-            last_str = (boost::format { "%d" } % ilast).str();
-        change_str = (boost::format { "%+d" } % ichange).str();
-    } else {
-        last_str = (boost::format { "%.2f" } % last).str();
-        change_str = (boost::format { "%+.2f" } % change).str();
+    if (m_cur_quote >= m_quotes.size())
+        return;
+
+    if (m_render_cache.size() < m_quotes.size())
+        m_render_cache.resize(m_quotes.size());
+
+    const auto quote = m_quotes.snapshot[m_cur_quote].load();
+
+    auto& entry = m_render_cache[m_cur_quote];
+
+    if (entry.pixmap == None)
+        entry.pixmap = XCreatePixmap(m_display, m_root_window, WINDOW_SIZE, WINDOW_SIZE, DefaultDepth(m_display, m_screen));
+
+    const auto history_serial = m_history.serial(m_cur_quote);
+    const auto flash = flash_font(m_cur_quote);
+    const bool arrived { entry.valid && quote.received != entry.rendered.received };
+
+    if (!entry.valid || !same_frame(entry.rendered, quote) || entry.history_serial != history_serial || entry.flash != flash) {
+        pixmap_target target { m_display, m_normal_gc, m_font_pixmaps, m_black_pixel, m_graph_pixel, entry.pixmap };
+        m_renderer.compose(target, m_cur_quote, quote, flash);
+        entry.rendered = quote;
+        entry.history_serial = history_serial;
+        entry.flash = flash;
+        entry.valid = true;
     }
-    const auto percent_change_str = (boost::format { "%+.2f%%" } % percent_change).str();
 
-    int base_y { (WINDOW_SIZE - 4*CHAR_HEIGHT)/2 };
+    XEvent event;
+    while (XCheckTypedWindowEvent(m_display, m_icon_window, Expose, &event))
+        ;
+    XCopyArea(m_display, entry.pixmap, m_icon_window, m_normal_gc, 0, 0, WINDOW_SIZE, WINDOW_SIZE, 0, 0);
 
-    draw_string_centered(m_white_font_pixmap, symbol, base_y);
-    base_y += CHAR_HEIGHT;
+    while (XCheckTypedWindowEvent(m_display, m_window, Expose, &event))
+        ;
+    XCopyArea(m_display, entry.pixmap, m_window, m_normal_gc, 0, 0, WINDOW_SIZE, WINDOW_SIZE, 0, 0);
 
-    draw_string_centered(m_white_font_pixmap, last_str, base_y);
-    base_y += CHAR_HEIGHT;
+    const auto stats = m_engine.stats();
+    if (stats && arrived && quote.received)
+        stats->record_display(steady_clock_micros() - quote.received);
 
-    const auto change_font { change > 0 ? m_green_font_pixmap : m_red_font_pixmap };
-    draw_string_centered(change_font, change_str, base_y);
-    base_y += CHAR_HEIGHT;
+    // first frame showing actual values, whether cached or fetched
+    if (!m_painted && (quote.status == quote_status::FETCHED || quote.stale)) {
+        m_painted = true;
 
-    draw_string_centered(change_font, percent_change_str, base_y);
-}
+        const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - m_start_time).count();
 
-void wm_window::draw_wait(const std::string& symbol) const
-{
-    const int base_y { (WINDOW_SIZE - 2*CHAR_HEIGHT)/2 };
-    draw_string_centered(m_white_font_pixmap, symbol, base_y);
-    draw_string_centered(m_yellow_font_pixmap, "WAIT", base_y + CHAR_HEIGHT);
-}
+        if (stats)
+            stats->record_first_paint(elapsed);
 
-void wm_window::draw_error(const std::string& symbol) const
-{
-    const int base_y { (WINDOW_SIZE - 2*CHAR_HEIGHT)/2 };
-    draw_string_centered(m_white_font_pixmap, symbol, base_y);
-    draw_string_centered(m_red_font_pixmap, "ERROR", base_y + CHAR_HEIGHT);
+        if (m_verbose)
+            std::cerr << "first paint after " << elapsed << " ms" << (quote.stale ? " (from cache)" : "") << "\n";
+    }
 }
 
 void wm_window::run()
 {
-    while (true) {
-        const time_t now { time(nullptr) };
-
-        if (m_cur_quote < m_quotes.size()) {
-            std::unique_lock<std::mutex> lock { m_mutex };
-
-            auto& quote = m_quotes[m_cur_quote];
-
-            if (quote.state != quote_state::WAITING) {
-                bool update;
-                if (quote.last_update == static_cast<time_t>(0)) {
-                    update = true;
-                } else if (quote.state == quote_state::FETCHED) {
-                    update = now - quote.last_update >= m_update_interval;
-                } else if (quote.state == quote_state::ERROR && quote.retries < m_max_retries) {
-                    update = now - quote.last_update >= m_retry_interval;
-                } else {
-                    update = false;
-                }
-
-                if (update) {
-                    ++quote.retries;
-                    quote.state = quote_state::WAITING;
-                    m_quote_fetcher->fetch(quote.symbol);
-                }
-            }
-        }
+    m_dirty = true;
+    m_engine.start();
 
-        // XXX should only do this when we get an update
-        redraw_window();
+    while (!m_engine.stopped()) {
+        m_updated.clear();
+        m_engine.reschedule_completed(m_updated);
 
-        while (XPending(m_display)) {
-            XEvent event;
-            XNextEvent(m_display, &event);
+        if (std::find(std::begin(m_updated), std::end(m_updated), m_cur_quote) != std::end(m_updated))
+            m_dirty = true;
 
-            switch (event.type) {
-            case Expose:
-                // redraw_window();
-                break;
+        show_alerts();
 
-            case ButtonPress:
-                if (++m_cur_quote == m_quotes.size())
-                    m_cur_quote = 0;
-                // redraw_window();
-                break;
+        // the config may have dropped the quote on display
+        if (m_cur_quote < m_quotes.size() && m_quotes.hidden[m_cur_quote]) {
+            next_quote();
+            m_dirty = true;
+        }
 
-            case ClientMessage:
-                if (event.xclient.data.l[0] == static_cast<int>(m_delete_window))
-                    return;
+        m_engine.schedule_updates();
 
-            default:
-                break;
-            }
+        if (m_dirty) {
+            redraw_window();
+            m_dirty = false;
         }
 
-        XFlush(m_display);
+        wait_for_events();
 
-        usleep(50000l);
+        if (!process_events())
+            return;
+    }
+}
+
+void wm_window::next_quote()
+{
+    // skip the symbols we only fetch for other instances or that were removed
+    for (size_t i = 0; i < m_quotes.size(); ++i) {
+        if (++m_cur_quote == m_quotes.size())
+            m_cur_quote = 0;
+        if (!m_quotes.hidden[m_cur_quote])
+            break;
     }
 }
 
-void wm_window::set_quote_state(const std::string& symbol, double last, double change, double percent_change)
+void wm_window::show_alerts()
 {
-    std::unique_lock<std::mutex> lock { m_mutex };
-
-    auto it = std::find_if(std::begin(m_quotes),
-                        std::end(m_quotes),
-                        [&](const quote_state& quote) { return quote.symbol == symbol; });
-    if (it != std::end(m_quotes)) {
-        auto& quote = *it;
-        quote.last = last;
-        quote.change = change;
-        quote.percent_change = percent_change;
-        quote.state = quote_state::FETCHED;
-        quote.last_update = time(nullptr);
-        quote.retries = 0;
+    // switch to a quote as soon as an alert fires for it
+
+    if (m_alerted.size() < m_quotes.size())
+        m_alerted.resize(m_quotes.size());
+
+    for (auto id : m_updated) {
+        if (m_quotes.alerted[id] != m_alerted[id]) {
+            m_alerted[id] = m_quotes.alerted[id];
+            m_cur_quote = id;
+            m_dirty = true;
+        }
     }
+
+    // and keep changing its colors while it flashes
+    if (m_cur_quote < m_render_cache.size() && m_render_cache[m_cur_quote].flash != flash_font(m_cur_quote))
+        m_dirty = true;
+}
+
+font_color wm_window::flash_font(quote_id id) const
+{
+    const time_t now { time(nullptr) };
+
+    if (m_quotes.alerted[id] <= now)
+        return font_color::NONE;
+
+    return now%2 ? font_color::RED : font_color::YELLOW;
 }
 
-void wm_window::set_quote_error(const std::string& symbol)
+void wm_window::wait_for_events()
 {
-    std::unique_lock<std::mutex> lock { m_mutex };
-
-    auto it = std::find_if(std::begin(m_quotes),
-                        std::end(m_quotes),
-                        [&](const quote_state& quote) { return quote.symbol == symbol; });
-    if (it != std::end(m_quotes)) {
-        auto& quote = *it;
-        quote.state = quote_state::ERROR;
-        quote.last_update = time(nullptr);
+    // XPending flushes the output buffer; only block if Xlib hasn't already queued something
+
+    if (XPending(m_display))
+        return;
+
+    m_engine.wait_for_events(ConnectionNumber(m_display));
+}
+
+bool wm_window::process_events()
+{
+    while (XPending(m_display)) {
+        XEvent event;
+        XNextEvent(m_display, &event);
+
+        switch (event.type) {
+        case Expose:
+            m_dirty = true;
+            break;
+
+        case ButtonPress:
+            next_quote();
+            m_dirty = true;
+            break;
+
+        case ClientMessage:
+            if (event.xclient.data.l[0] == static_cast<int>(m_delete_window))
+                return false;
+
+        default:
+            break;
+        }
     }
+
+    return true;
 }